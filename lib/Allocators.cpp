@@ -0,0 +1 @@
+#include "Allocators.h"
\ No newline at end of file
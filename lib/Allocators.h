@@ -0,0 +1,281 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <span>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+// Memory for the buffers beyond std::allocator. MonotonicArena and FixedPool are std::pmr memory
+// resources, used through std::pmr::polymorphic_allocator, e.g.
+//     MonotonicArena arena;
+//     ExtBuffer<int, std::pmr::polymorphic_allocator<int>> buffer(16, &arena);
+// HugePageAllocator and AlignedAllocator are plain stateless allocators.
+
+// Bump allocator for short-lived buffers: memory comes from chunks of the upstream resource (or from a
+// caller-provided initial block, e.g. on the stack), is never reused, and is all given back at once by
+// release() or the destructor. Deallocation is free. Not thread-safe.
+class MonotonicArena : public std::pmr::memory_resource {
+    struct Chunk {
+        Chunk* next;
+        size_t bytes;
+    };
+
+    std::pmr::memory_resource* upstream_;
+    Chunk* chunks_ = nullptr;
+    std::byte* current_ = nullptr;
+    size_t left_ = 0;
+    size_t next_chunk_bytes_;
+    size_t allocated_ = 0;
+    std::span<std::byte> initial_;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* memory = current_;
+        if (std::align(alignment, bytes, memory, left_) == nullptr) {
+            const size_t chunk_bytes = std::max(next_chunk_bytes_, sizeof(Chunk) + bytes + alignment);
+            auto* chunk = static_cast<Chunk*>(upstream_->allocate(chunk_bytes, alignof(std::max_align_t)));
+            chunks_ = new(chunk) Chunk{chunks_, chunk_bytes};
+            current_ = reinterpret_cast<std::byte*>(chunk + 1);
+            left_ = chunk_bytes - sizeof(Chunk);
+            next_chunk_bytes_ *= 2;
+            memory = current_;
+            std::align(alignment, bytes, memory, left_);
+        }
+        current_ = static_cast<std::byte*>(memory) + bytes;
+        left_ -= bytes;
+        allocated_ += bytes;
+        return memory;
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+public:
+    explicit MonotonicArena(size_t chunk_bytes = size_t(1) << 16,
+                            std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) :
+            upstream_(upstream), next_chunk_bytes_(std::max(chunk_bytes, sizeof(Chunk) * 2)) {}
+
+    explicit MonotonicArena(std::span<std::byte> initial,
+                            std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) :
+            upstream_(upstream), current_(initial.data()), left_(initial.size()),
+            next_chunk_bytes_(std::max<size_t>(initial.size(), 1024)), initial_(initial) {}
+
+    MonotonicArena(const MonotonicArena&) = delete;
+
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    ~MonotonicArena() override {
+        release();
+    }
+
+    // Frees every chunk; everything allocated from the arena becomes invalid.
+    void release() noexcept {
+        while (chunks_ != nullptr) {
+            Chunk* next = chunks_->next;
+            upstream_->deallocate(chunks_, chunks_->bytes, alignof(std::max_align_t));
+            chunks_ = next;
+        }
+        current_ = initial_.data();
+        left_ = initial_.size();
+        allocated_ = 0;
+    }
+
+    // Bytes handed out since construction or the last release().
+    size_t allocated() const noexcept {
+        return allocated_;
+    }
+};
+
+// Pool of equally sized blocks kept on a free list, for buffers that are created and destroyed over and
+// over with about the same capacity. Requests up to block_bytes() are served from the pool, larger or
+// over-aligned ones go to the upstream resource. Blocks are carved from chunks of blocks_per_chunk
+// blocks, which are only freed with the pool. Not thread-safe.
+class FixedPool : public std::pmr::memory_resource {
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct Chunk {
+        Chunk* next;
+    };
+
+    std::pmr::memory_resource* upstream_;
+    size_t block_bytes_;
+    size_t blocks_per_chunk_;
+    FreeBlock* free_ = nullptr;
+    Chunk* chunks_ = nullptr;
+    size_t chunk_count_ = 0;
+
+    static constexpr size_t kBlockAlignment = alignof(std::max_align_t);
+
+    size_t ChunkBytes() const noexcept {
+        return kBlockAlignment + block_bytes_ * blocks_per_chunk_;
+    }
+
+    void AddChunk() {
+        auto* memory = static_cast<std::byte*>(upstream_->allocate(ChunkBytes(), kBlockAlignment));
+        chunks_ = new(memory) Chunk{chunks_};
+        ++chunk_count_;
+        for (size_t i = blocks_per_chunk_; i-- > 0;) {
+            free_ = new(memory + kBlockAlignment + i * block_bytes_) FreeBlock{free_};
+        }
+    }
+
+    bool Pooled(size_t bytes, size_t alignment) const noexcept {
+        return bytes <= block_bytes_ && alignment <= kBlockAlignment;
+    }
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (!Pooled(bytes, alignment)) {
+            return upstream_->allocate(bytes, alignment);
+        }
+        if (free_ == nullptr) {
+            AddChunk();
+        }
+        FreeBlock* block = free_;
+        free_ = block->next;
+        return block;
+    }
+
+    void do_deallocate(void* memory, size_t bytes, size_t alignment) override {
+        if (!Pooled(bytes, alignment)) {
+            upstream_->deallocate(memory, bytes, alignment);
+            return;
+        }
+        free_ = new(memory) FreeBlock{free_};
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+public:
+    FixedPool(size_t block_bytes, size_t blocks_per_chunk = 64,
+              std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) :
+            upstream_(upstream),
+            block_bytes_((std::max(block_bytes, sizeof(FreeBlock)) + kBlockAlignment - 1) / kBlockAlignment * kBlockAlignment),
+            blocks_per_chunk_(std::max<size_t>(blocks_per_chunk, 1)) {}
+
+    FixedPool(const FixedPool&) = delete;
+
+    FixedPool& operator=(const FixedPool&) = delete;
+
+    ~FixedPool() override {
+        while (chunks_ != nullptr) {
+            Chunk* next = chunks_->next;
+            upstream_->deallocate(chunks_, ChunkBytes(), kBlockAlignment);
+            chunks_ = next;
+        }
+    }
+
+    size_t block_bytes() const noexcept {
+        return block_bytes_;
+    }
+
+    // Chunks taken from the upstream resource so far.
+    size_t chunks() const noexcept {
+        return chunk_count_;
+    }
+};
+
+// Allocations of at least one huge page (2 MiB) get their own mapping, aligned to a huge page and marked
+// for transparent huge pages, so that a large ring needs far fewer TLB entries. Smaller ones use operator
+// new. On systems other than Linux every allocation uses operator new.
+template<typename T>
+struct HugePageAllocator {
+    using value_type = T;
+
+    static constexpr size_t kHugePageBytes = size_t(2) << 20;
+
+    HugePageAllocator() noexcept = default;
+
+    template<typename U>
+    HugePageAllocator(const HugePageAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > SIZE_MAX / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        const size_t bytes = n * sizeof(T);
+#if defined(__linux__)
+        if (bytes >= kHugePageBytes) {
+            const size_t mapped = RoundUp(bytes);
+            // Map one huge page more than needed and trim the ends to get an aligned range.
+            void* memory = mmap(nullptr, mapped + kHugePageBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            auto* start = static_cast<std::byte*>(memory);
+            const auto address = reinterpret_cast<uintptr_t>(start);
+            auto* aligned = start + (RoundUp(address) - address);
+            if (aligned != start) {
+                munmap(start, static_cast<size_t>(aligned - start));
+            }
+            munmap(aligned + mapped, static_cast<size_t>(start + mapped + kHugePageBytes - (aligned + mapped)));
+            madvise(aligned, mapped, MADV_HUGEPAGE);
+            return reinterpret_cast<T*>(aligned);
+        }
+#endif
+        return static_cast<T*>(::operator new(bytes, std::align_val_t{alignof(T)}));
+    }
+
+    void deallocate(T* memory, size_t n) noexcept {
+        const size_t bytes = n * sizeof(T);
+#if defined(__linux__)
+        if (bytes >= kHugePageBytes) {
+            munmap(memory, RoundUp(bytes));
+            return;
+        }
+#endif
+        ::operator delete(memory, bytes, std::align_val_t{alignof(T)});
+    }
+
+    friend bool operator==(const HugePageAllocator&, const HugePageAllocator&) noexcept {
+        return true;
+    }
+private:
+    static constexpr size_t RoundUp(size_t value) noexcept {
+        return (value + kHugePageBytes - 1) / kHugePageBytes * kHugePageBytes;
+    }
+};
+
+// Storage aligned to `Alignment` bytes (a cache line by default), so that the first element of a buffer
+// that has not wrapped yet starts an aligned SIMD load.
+template<typename T, size_t Alignment = 64>
+struct AlignedAllocator {
+    static_assert(std::has_single_bit(Alignment) && Alignment >= alignof(T), "bad alignment");
+
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > SIZE_MAX / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{Alignment}));
+    }
+
+    void deallocate(T* memory, size_t n) noexcept {
+        ::operator delete(memory, n * sizeof(T), std::align_val_t{Alignment});
+    }
+
+    friend bool operator==(const AlignedAllocator&, const AlignedAllocator&) noexcept {
+        return true;
+    }
+};
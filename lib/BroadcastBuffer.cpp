@@ -0,0 +1 @@
+#include "BroadcastBuffer.h"
\ No newline at end of file
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+
+#include "Buffer.h"
+#include "CacheLine.h"
+
+// What BroadcastBuffer does when the writer catches up with a consumer that has not read a slot yet:
+// GateOnSlowest holds the writer back (claim returns fewer slots), DropSlowConsumers detaches the
+// consumer, which then has to attach again, and lets the writer go on.
+struct GateOnSlowest {};
+struct DropSlowConsumers {};
+
+// Ring with one writer and a fixed set of consumers that each read every element at their own pace. The
+// slots are constructed once, in a full MaskedBuffer, and reused: the writer claims a batch of slots,
+// fills them and publishes the batch with one release store; a consumer gets the published slots it has
+// not seen as (at most two) spans of stable references into the ring and releases them when done, so no
+// element is copied per consumer.
+//
+// Every consumer has its own cursor on its own cache line. With DropSlowConsumers a consumer sets
+// kReading in its cursor while it holds spans; the writer only detaches consumers that hold none and is
+// gated by the others, as with GateOnSlowest.
+template<typename T, typename Policy = GateOnSlowest, typename alloc = std::allocator<T>>
+class BroadcastBuffer {
+    static_assert(std::is_same_v<Policy, GateOnSlowest> || std::is_same_v<Policy, DropSlowConsumers>, "unknown slow consumer policy");
+    static_assert(std::default_initializable<T>, "the slots are constructed up front");
+
+    static constexpr bool kDrop = std::is_same_v<Policy, DropSlowConsumers>;
+    static constexpr uint64_t kReading = uint64_t(1) << 63;
+    static constexpr uint64_t kDetached = std::numeric_limits<uint64_t>::max();
+    // Cursor of a consumer inside attach(). It has kReading set, so the writer never detaches it.
+    static constexpr uint64_t kAttaching = kDetached - 1;
+
+    struct alignas(kCacheLineSize) Cursor {
+        std::atomic<uint64_t> position{0};
+        uint64_t seen_published = 0;
+    };
+public:
+    using pointer = T*;
+    using size_type = size_t;
+    using value_type = T;
+    using view_type = std::pair<std::span<const T>, std::span<const T>>;
+    using claim_type = std::pair<std::span<T>, std::span<T>>;
+private:
+    MaskedBuffer<T, alloc> storage_;
+    pointer slots_ = nullptr;
+    uint64_t capacity_ = 0;
+    uint64_t mask_ = 0;
+    size_type consumer_count_ = 0;
+    std::unique_ptr<Cursor[]> cursors_;
+
+    // Writer: the published positions, the size of the pending claim and the positions below which no
+    // attached consumer reads any more.
+    alignas(kCacheLineSize) std::atomic<uint64_t> published_{0};
+    uint64_t claimed_ = 0;
+    uint64_t free_below_ = 0;
+
+    template<typename Span>
+    std::pair<Span, Span> Pieces(uint64_t position, uint64_t count) const {
+        const uint64_t slot = position & mask_;
+        const uint64_t first = std::min(count, capacity_ - slot);
+        return {Span(slots_ + slot, first), Span(slots_, count - first)};
+    }
+
+    Cursor& CursorOf(size_type consumer) const {
+        if (consumer >= consumer_count_) {
+            throw std::invalid_argument("No such consumer");
+        }
+        return cursors_[consumer];
+    }
+
+    // Number of slots from `published` on that the writer may reuse right now, at most `count`.
+    uint64_t Room(uint64_t published, uint64_t count) {
+        if (published + count <= free_below_ + capacity_) {
+            return count;
+        }
+        uint64_t lowest = published;
+        // Pairs with the fence in attach(): either this scan sees the consumer attaching, or the consumer
+        // sees every position published before it.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (size_type i = 0; i < consumer_count_; ++i) {
+            std::atomic<uint64_t>& position = cursors_[i].position;
+            uint64_t cursor = position.load(std::memory_order_acquire);
+            if constexpr (kDrop) {
+                const uint64_t needed = published + count - capacity_;
+                while (cursor != kDetached && (cursor & kReading) == 0 && cursor < needed &&
+                       !position.compare_exchange_weak(cursor, kDetached, std::memory_order_acq_rel, std::memory_order_acquire)) {}
+            }
+            if (cursor == kAttaching) {
+                lowest = std::min(lowest, free_below_);
+            } else if (cursor != kDetached) {
+                lowest = std::min(lowest, cursor & ~kReading);
+            }
+        }
+        free_below_ = lowest;
+        return std::min(count, lowest + capacity_ - published);
+    }
+public:
+    BroadcastBuffer(const size_type capacity, const size_type consumers) :
+            storage_(T(), std::bit_ceil(std::max<size_type>(capacity, 1))),
+            slots_(&storage_[0]),
+            capacity_(storage_.max_size()),
+            mask_(capacity_ - 1),
+            consumer_count_(consumers),
+            cursors_(std::make_unique<Cursor[]>(consumers)) {}
+
+    BroadcastBuffer(const BroadcastBuffer&) = delete;
+
+    BroadcastBuffer& operator=(const BroadcastBuffer&) = delete;
+
+    // Writer side.
+
+    // Up to `count` writable slots after the published ones; fewer (or none) while consumers gate the
+    // writer. The slots hold the elements written a lap earlier.
+    claim_type claim(size_type count) {
+        count = std::min<uint64_t>(count, capacity_);
+        const uint64_t published = published_.load(std::memory_order_relaxed);
+        claimed_ = Room(published, count);
+        return Pieces<std::span<T>>(published, claimed_);
+    }
+
+    // Makes the first `count` claimed slots visible to the consumers.
+    void publish(size_type count) {
+        if (count > claimed_) {
+            throw std::invalid_argument("Publishing more slots than claimed");
+        }
+        claimed_ = 0;
+        published_.store(published_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    bool push_back(const value_type& value) {
+        auto [first, second] = claim(1);
+        if (first.empty()) {
+            return false;
+        }
+        first[0] = value;
+        publish(1);
+        return true;
+    }
+
+    // Publishes as many elements of `values` as there is room for and returns their number.
+    size_type push_back(std::span<const value_type> values) {
+        auto [first, second] = claim(values.size());
+        std::copy_n(values.begin(), first.size(), first.begin());
+        std::copy_n(values.begin() + first.size(), second.size(), second.begin());
+        publish(first.size() + second.size());
+        return first.size() + second.size();
+    }
+
+    // Consumer side; every consumer may run on its own thread.
+
+    // The published elements the consumer has not released yet, at most `count` of them, in order. They
+    // stay in place until the consumer releases them. A detached consumer gets nothing.
+    view_type read(size_type consumer, size_type count = std::numeric_limits<size_type>::max()) {
+        Cursor& cursor = CursorOf(consumer);
+        uint64_t position = cursor.position.load(std::memory_order_acquire);
+        if (position == kDetached) {
+            return {};
+        }
+        position &= ~kReading;
+        if (cursor.seen_published - position < count) {
+            cursor.seen_published = published_.load(std::memory_order_acquire);
+        }
+        if constexpr (kDrop) {
+            uint64_t expected = position;
+            if (!cursor.position.compare_exchange_strong(expected, position | kReading, std::memory_order_acq_rel) &&
+                expected != (position | kReading)) {
+                return {};
+            }
+        }
+        return Pieces<std::span<const T>>(position, std::min<uint64_t>(count, cursor.seen_published - position));
+    }
+
+    // Moves the consumer past `count` elements returned by the last read.
+    void release(size_type consumer, size_type count) {
+        Cursor& cursor = CursorOf(consumer);
+        uint64_t position = cursor.position.load(std::memory_order_relaxed);
+        if constexpr (kDrop) {
+            // The writer may detach a consumer that holds no spans at any moment; that must stick.
+            while (position != kDetached &&
+                   !cursor.position.compare_exchange_weak(position, (position & ~kReading) + count, std::memory_order_acq_rel,
+                                                          std::memory_order_relaxed)) {}
+        } else {
+            cursor.position.store(position + count, std::memory_order_release);
+        }
+    }
+
+    // Copies up to out.size() unread elements into `out`, releases them and returns their number.
+    size_type read_into(size_type consumer, std::span<value_type> out) {
+        const auto [first, second] = read(consumer, out.size());
+        std::copy(first.begin(), first.end(), out.begin());
+        std::copy(second.begin(), second.end(), out.begin() + first.size());
+        release(consumer, first.size() + second.size());
+        return first.size() + second.size();
+    }
+
+    bool detached(size_type consumer) const {
+        return CursorOf(consumer).position.load(std::memory_order_acquire) == kDetached;
+    }
+
+    // Stops the consumer from gating the writer.
+    void detach(size_type consumer) {
+        CursorOf(consumer).position.store(kDetached, std::memory_order_release);
+    }
+
+    // (Re)starts the consumer at the elements published from now on.
+    //
+    // Reading published_ and then storing it as the cursor would race with the writer: while the cursor
+    // still says kDetached, the writer may lap the position read and reuse its slots. So the cursor is
+    // first set to kAttaching, which keeps the writer below the reuse limit it already had. The seq_cst
+    // fences here and in Room() make sure that published_, read after that, is at least every position
+    // the writer published before its last scan that missed kAttaching, so the limit the writer may use
+    // never passes the position stored at the end.
+    void attach(size_type consumer) {
+        Cursor& cursor = CursorOf(consumer);
+        cursor.position.exchange(kAttaching, std::memory_order_acq_rel);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cursor.seen_published = published_.load(std::memory_order_acquire);
+        cursor.position.store(cursor.seen_published, std::memory_order_release);
+    }
+
+    size_type capacity() const noexcept {
+        return capacity_;
+    }
+
+    size_type consumers() const noexcept {
+        return consumer_count_;
+    }
+};
@@ -1,34 +1,64 @@
+#pragma once
+
 #include <iostream>
 #include <memory>
 #include <initializer_list>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <concepts>
+#include <cstring>
+#include <new>
+#include <bit>
+#include <compare>
+#include <iterator>
+#include <span>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "Snapshot.h"
 
 const static size_t kCapacityCoefficient = 2;
 
 template<typename T>
 class Iter : public std::iterator_traits<T> {
+    template<typename>
+    friend class Iter;
 public:
     using iterator_category = std::random_access_iterator_tag;
+    using difference_type = std::ptrdiff_t;
     using pointer = T*;
     using size_type = size_t;
     using reference = T&;
-    using value_type = T;
+    using value_type = std::remove_cv_t<T>;
 private:
     pointer begin_ = nullptr;
     pointer end_ = nullptr;
     pointer current_ptr_ = nullptr;
     size_type size_ = 0;
+    // Position counted from the start of the storage without wrapping, so that distances and ordering
+    // stay correct for ranges that run past the end of the storage and continue from its beginning.
+    difference_type index_ = 0;
+
+    constexpr pointer Locate(const difference_type index) const {
+        const auto size = static_cast<difference_type>(size_);
+        return begin_ + ((index % size) + size) % size;
+    }
 public:
 
     Iter() = default;
 
-    Iter(pointer buff, size_type size) : begin_(buff), end_(buff + size - 1), current_ptr_(buff), size_(size) {}
+    Iter(pointer buff, size_type size) : begin_(buff), end_(size == 0 ? buff : buff + size - 1), current_ptr_(buff), size_(size) {}
 
-    Iter(pointer buff, pointer new_current, size_type size) : begin_(buff), end_(buff + size - 1), current_ptr_(new_current), size_(size) {}
+    Iter(pointer buff, pointer new_current, size_type size) : begin_(buff), end_(size == 0 ? buff : buff + size - 1), current_ptr_(new_current), size_(size), index_(new_current - buff) {}
 
-    Iter(const Iter& other) : begin_(other.begin_), end_(other.end_), current_ptr_(other.current_ptr_), size_(other.size_) {}
+    Iter(const Iter& other) = default;
 
     constexpr bool operator==(const Iter& other) const {
-        return current_ptr_ == other.current_ptr_;
+        return index_ == other.index_;
     }
 
     constexpr bool operator==(pointer other) const {
@@ -36,19 +66,10 @@ public:
     }
 
     constexpr bool operator!=(const Iter& other) const {
-        return current_ptr_ != other.current_ptr_;
+        return index_ != other.index_;
     }
 
-    constexpr Iter& operator=(const Iter& other) {
-        if (this == &other) {
-            return *this;
-        }
-        begin_ = other.begin_;
-        end_ = other.end_;
-        current_ptr_ = other.current_ptr_;
-        size_ = other.size_;
-        return *this;
-    }
+    constexpr Iter& operator=(const Iter& other) = default;
 
     constexpr Iter& operator++() {
         if (current_ptr_ == end_) {
@@ -56,16 +77,13 @@ public:
         } else {
             ++current_ptr_;
         }
+        ++index_;
         return *this;
     }
 
     constexpr Iter operator++(int) {
         Iter temp = *this;
-        if (current_ptr_ == end_) {
-            current_ptr_ = begin_;
-        } else {
-            ++current_ptr_;
-        }
+        ++*this;
         return temp;
     }
 
@@ -75,115 +93,318 @@ public:
         } else {
             current_ptr_--;
         }
+        --index_;
         return *this;
     }
 
     constexpr Iter operator--(int) {
         Iter temp = *this;
-        if (current_ptr_ == begin_) {
-            current_ptr_ = end_;
-        } else {
-            current_ptr_--;
-        }
+        --*this;
         return temp;
     }
 
-    constexpr Iter operator+(const int64_t n) {
-        Iter<value_type> temp = *this;
-        if (n >= 0) {
-            if (n > temp.end_ - temp.current_ptr_) {
-                temp.current_ptr_ = temp.begin_ + (n - (temp.end_ - temp.current_ptr_ + 1));
-            } else {
-                temp.current_ptr_ += n;
-            }
-        } else {
-            if (n > current_ptr_ - begin_) {
-                temp.current_ptr_ = temp.end_ - (n - (temp.current_ptr_ - temp.begin_ + 1));
-            } else {
-                temp.current_ptr_ -= n;
-            }
+    constexpr Iter operator+(const int64_t n) const {
+        Iter<T> temp = *this;
+        // A ring without slots has nothing to locate (and Locate would divide by zero).
+        if (n == 0 || size_ == 0) {
+            return temp;
         }
+        temp.index_ += n;
+        temp.current_ptr_ = Locate(temp.index_);
         return temp;
     }
 
-    constexpr Iter operator-(const int64_t n) {
-        Iter<value_type> temp = *this;
-        if (n >= 0) {
-            if (n > current_ptr_ - begin_) {
-                temp.current_ptr_ = temp.end_ - (n - (temp.current_ptr_ - temp.begin_ + 1));
-            } else {
-                temp.current_ptr_ -= n;
-            }
-        } else {
-            if (n > temp.end_ - temp.current_ptr_) {
-                temp.current_ptr_ = temp.begin_ + (n - (temp.end_ - temp.current_ptr_ + 1));
-            } else {
-                temp.current_ptr_ += n;
-            }
-        }
-        return temp;
+    friend constexpr Iter operator+(const int64_t n, const Iter& iter) {
+        return iter + n;
     }
 
-    constexpr size_type operator-(const Iter& other) const {
-        int distance = current_ptr_ - other.current_ptr_;
-        if (distance >= 0) {
-            return distance;
-        } else {
-            return (size_ + distance);
-        }
+    constexpr Iter operator-(const int64_t n) const {
+        return *this + (-n);
+    }
+
+    constexpr difference_type operator-(const Iter& other) const {
+        return index_ - other.index_;
     }
 
     constexpr Iter& operator+=(const int64_t n) {
-        if (n >= 0) {
-            *this = *this + n;
-            return *this;
-        } else {
-            *this = *this - (-1 * n);
-            return *this;
-        }
+        return *this = *this + n;
     }
 
-    constexpr reference operator*() {
+    constexpr Iter& operator-=(const int64_t n) {
+        return *this = *this - n;
+    }
+
+    constexpr reference operator*() const {
         return *current_ptr_;
     }
 
-    constexpr Iter& operator[](const int64_t n) {
-        return *this += n;
+    constexpr reference operator[](const int64_t n) const {
+        return *(*this + n);
     }
 
-    constexpr bool operator>(const Iter& other) {
-        return current_ptr_ > other.current_ptr_;
+    constexpr bool operator>(const Iter& other) const {
+        return index_ > other.index_;
     }
 
-    constexpr bool operator<(const Iter& other) {
-        return current_ptr_ < other.current_ptr_;
+    constexpr bool operator<(const Iter& other) const {
+        return index_ < other.index_;
     }
 
-    constexpr bool operator>=(const Iter& other) {
-        return current_ptr_ >= other.current_ptr_;
+    constexpr bool operator>=(const Iter& other) const {
+        return index_ >= other.index_;
     }
 
-    constexpr bool operator<=(const Iter& other) {
-        return current_ptr_ <= other.current_ptr_;
+    constexpr bool operator<=(const Iter& other) const {
+        return index_ <= other.index_;
     }
 
     Iter<const T> MakeConst() const noexcept {
         Iter<const T> iter = Iter<const T>(begin_, current_ptr_, size_);
+        iter.index_ = index_;
         return iter;
     }
 
+    // The elements from here up to the end of the storage, at most `count` of them.
+    std::span<T> Run(const size_type count) const noexcept {
+        return {current_ptr_, std::min(count, static_cast<size_type>(end_ - current_ptr_) + 1)};
+    }
+
+};
+
+// Iterator of a ring whose size is a power of two: the storage, a logical position that only ever moves
+// forward or backward without wrapping, and the mask that maps it to a slot. Advancing is plain integer
+// arithmetic and dereferencing is `base[index & mask]`, with no branch on the wraparound, so loops over
+// it can be unrolled. The 64-bit positions keep distances and ordering exact however often the ring wraps.
+template<typename T>
+class MaskedIter {
+    template<typename>
+    friend class MaskedIter;
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using size_type = size_t;
+    using reference = T&;
+    using value_type = std::remove_cv_t<T>;
+private:
+    pointer base_ = nullptr;
+    difference_type index_ = 0;
+    difference_type mask_ = 0;
+public:
+    MaskedIter() = default;
+
+    // `size` must be a power of two (or zero for a ring without storage).
+    MaskedIter(pointer buff, size_type size) : base_(buff), mask_(static_cast<difference_type>(size) - 1) {}
+
+    MaskedIter(pointer buff, difference_type index, size_type size) : base_(buff), index_(index), mask_(static_cast<difference_type>(size) - 1) {}
+
+    constexpr bool operator==(const MaskedIter& other) const {
+        return index_ == other.index_;
+    }
+
+    constexpr auto operator<=>(const MaskedIter& other) const {
+        return index_ <=> other.index_;
+    }
+
+    constexpr MaskedIter& operator++() {
+        ++index_;
+        return *this;
+    }
+
+    constexpr MaskedIter operator++(int) {
+        MaskedIter temp = *this;
+        ++index_;
+        return temp;
+    }
+
+    constexpr MaskedIter& operator--() {
+        --index_;
+        return *this;
+    }
+
+    constexpr MaskedIter operator--(int) {
+        MaskedIter temp = *this;
+        --index_;
+        return temp;
+    }
+
+    constexpr MaskedIter& operator+=(const difference_type n) {
+        index_ += n;
+        return *this;
+    }
+
+    constexpr MaskedIter& operator-=(const difference_type n) {
+        index_ -= n;
+        return *this;
+    }
+
+    constexpr MaskedIter operator+(const difference_type n) const {
+        MaskedIter temp = *this;
+        return temp += n;
+    }
+
+    friend constexpr MaskedIter operator+(const difference_type n, const MaskedIter& iter) {
+        return iter + n;
+    }
+
+    constexpr MaskedIter operator-(const difference_type n) const {
+        MaskedIter temp = *this;
+        return temp -= n;
+    }
+
+    constexpr difference_type operator-(const MaskedIter& other) const {
+        return index_ - other.index_;
+    }
+
+    constexpr reference operator*() const {
+        return base_[index_ & mask_];
+    }
+
+    constexpr pointer operator->() const {
+        return base_ + (index_ & mask_);
+    }
+
+    constexpr reference operator[](const difference_type n) const {
+        return base_[(index_ + n) & mask_];
+    }
+
+    MaskedIter<const T> MakeConst() const noexcept {
+        return MaskedIter<const T>(base_, index_, static_cast<size_type>(mask_ + 1));
+    }
+
+    // The elements from here up to the end of the storage, at most `count` of them.
+    std::span<T> Run(const size_type count) const noexcept {
+        const difference_type slot = index_ & mask_;
+        return {base_ + slot, std::min(count, static_cast<size_type>(mask_ - slot) + 1)};
+    }
 };
 
+// Storage layouts of Buffer. ExactCapacity holds exactly the requested number of elements and walks the
+// storage with Iter. PowerOfTwoCapacity rounds the capacity up to a power of two and walks it with
+// MaskedIter, which needs no spare slot to tell a full ring from an empty one.
+struct ExactCapacity {};
+struct PowerOfTwoCapacity {};
+
+// Bulk transfers between a ring of `slots` slots and a range. `count` elements starting at slot `slot`
+// occupy at most two contiguous pieces of the storage: up to its end, then from its start. Trivially
+// copyable elements are copied one piece at a time with memcpy.
+
+template<typename Alloc, typename T, std::forward_iterator U>
+void RingConstruct(Alloc& allocator, T* buff, size_t slots, size_t slot, U first, size_t count) {
+    const size_t first_piece = std::min(count, slots - slot);
+    if constexpr (std::is_trivially_copyable_v<T> && std::contiguous_iterator<U> && std::is_same_v<std::iter_value_t<U>, T>) {
+        const T* source = std::to_address(first);
+        if (first_piece != 0) {
+            std::memcpy(static_cast<void*>(buff + slot), static_cast<const void*>(source), first_piece * sizeof(T));
+        }
+        if (count != first_piece) {
+            std::memcpy(static_cast<void*>(buff), static_cast<const void*>(source + first_piece), (count - first_piece) * sizeof(T));
+        }
+    } else {
+        size_t done = 0;
+        auto at = [&](size_t i) { return i < first_piece ? buff + slot + i : buff + (i - first_piece); };
+        try {
+            for (; done < count; ++done, ++first) {
+                std::allocator_traits<Alloc>::construct(allocator, at(done), *first);
+            }
+        } catch (...) {
+            while (done-- > 0) {
+                std::allocator_traits<Alloc>::destroy(allocator, at(done));
+            }
+            throw;
+        }
+    }
+}
+
+// Moves `count` elements out of the ring into `out` and destroys them in the ring.
+template<typename Alloc, typename T>
+void RingMoveOut(Alloc& allocator, T* buff, size_t slots, size_t slot, T* out, size_t count) {
+    const size_t first_piece = std::min(count, slots - slot);
+    if constexpr (std::is_trivially_copyable_v<T>) {
+        if (first_piece != 0) {
+            std::memcpy(static_cast<void*>(out), static_cast<const void*>(buff + slot), first_piece * sizeof(T));
+        }
+        if (count != first_piece) {
+            std::memcpy(static_cast<void*>(out + first_piece), static_cast<const void*>(buff), (count - first_piece) * sizeof(T));
+        }
+    } else {
+        T* source = buff + slot;
+        for (size_t i = 0; i < count; ++i, ++source) {
+            if (i == first_piece) {
+                source = buff;
+            }
+            out[i] = std::move(*source);
+            std::allocator_traits<Alloc>::destroy(allocator, source);
+        }
+    }
+}
+
+// Copies `count` elements of a ring, starting at `first`, to the front of `buffer`: the source is read as
+// at most two contiguous runs, each a single RingConstruct. On failure the copies are destroyed.
+template<typename Alloc, typename T, typename It>
+void RingCopyFront(Alloc& allocator, T* buffer, size_t slots, It first, size_t count) {
+    size_t done = 0;
+    try {
+        while (done < count) {
+            const auto run = (first + static_cast<std::iter_difference_t<It>>(done)).Run(count - done);
+            RingConstruct(allocator, buffer, slots, done, run.begin(), run.size());
+            done += run.size();
+        }
+    } catch (...) {
+        while (done-- > 0) {
+            std::allocator_traits<Alloc>::destroy(allocator, buffer + done);
+        }
+        throw;
+    }
+}
+
+// Types whose operator== compares exactly the bytes of the objects. Integers, enums and pointers qualify;
+// specialize it for other types without padding whose operator== is memberwise equality.
+template<typename T>
+struct is_bitwise_comparable : std::bool_constant<std::is_integral_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>> {};
+
+template<typename T>
+inline constexpr bool is_bitwise_comparable_v = is_bitwise_comparable<T>::value;
+
+// Compares `count` elements of two rings. For bitwise comparable elements the stretches between the seams
+// of either ring are compared with memcmp, so at most three calls; other elements go through operator==.
+template<typename It, typename OtherIt>
+bool RingEqual(It first, OtherIt second, size_t count) {
+    using T = std::iter_value_t<It>;
+    if constexpr (is_bitwise_comparable_v<T> && std::is_same_v<T, std::iter_value_t<OtherIt>>) {
+        while (count != 0) {
+            const size_t n = std::min(first.Run(count).size(), second.Run(count).size());
+            if (std::memcmp(&(*first), &(*second), n * sizeof(T)) != 0) {
+                return false;
+            }
+            first += static_cast<std::iter_difference_t<It>>(n);
+            second += static_cast<std::iter_difference_t<OtherIt>>(n);
+            count -= n;
+        }
+        return true;
+    } else {
+        for (; count != 0; --count, ++first, ++second) {
+            if (!(*first == *second)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////        CCircularBuffer class       /////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-template<typename T, typename alloc = std::allocator<T>>
+template<typename T, typename alloc = std::allocator<T>, typename Layout = ExactCapacity>
 
 class Buffer {
+    static_assert(std::is_same_v<Layout, ExactCapacity> || std::is_same_v<Layout, PowerOfTwoCapacity>, "unknown buffer layout");
+
+    static constexpr bool kMasked = std::is_same_v<Layout, PowerOfTwoCapacity>;
 public:
-    using iterator = Iter<T>;
-    using const_iterator = Iter<const T>;
+    using iterator = std::conditional_t<kMasked, MaskedIter<T>, Iter<T>>;
+    using const_iterator = std::conditional_t<kMasked, MaskedIter<const T>, Iter<const T>>;
     using pointer = T*;
     using size_type = size_t;
     using reference = T&;
@@ -192,24 +413,78 @@ public:
 private:
     size_type capacity_ = 0;
     size_type size_ = 0;
-    alloc allocator;
-    pointer buff_;
+    [[no_unique_address]] alloc allocator;
+    pointer buff_ = nullptr;
     iterator head_;
     iterator tail_;
+    // Length of the snapshot mapping that holds the storage after load(path, LoadMode::Map), 0 while the
+    // storage comes from the allocator.
+    size_type mapped_bytes_ = 0;
+
+    static constexpr bool kPropagateOnCopy = std::allocator_traits<alloc>::propagate_on_container_copy_assignment::value;
+    static constexpr bool kPropagateOnMove = std::allocator_traits<alloc>::propagate_on_container_move_assignment::value;
+    static constexpr bool kPropagateOnSwap = std::allocator_traits<alloc>::propagate_on_container_swap::value;
+    static constexpr bool kAllocatorsEqual = std::allocator_traits<alloc>::is_always_equal::value;
+
+    // An exact ring keeps one slot free, so that its head and tail only meet when it is empty. Masked
+    // iterators compare logical positions, which differ by the capacity when the ring is full.
+    static constexpr size_type kSpareSlots = kMasked ? 0 : 1;
+
+    static constexpr size_type Slots(size_type capacity) {
+        if constexpr (kMasked) {
+            return capacity == 0 ? 0 : std::bit_ceil(capacity);
+        } else {
+            return capacity + 1;
+        }
+    }
+
+    size_type SlotOf(const iterator& it) const noexcept {
+        return capacity_ == 0 ? 0 : static_cast<size_type>(&(*it) - buff_);
+    }
+
+    void FreeStorage() {
+        if (mapped_bytes_ != 0) {
+            UnmapSnapshot(reinterpret_cast<std::byte*>(buff_), std::exchange(mapped_bytes_, 0));
+        } else if (buff_ != nullptr) {
+            std::allocator_traits<alloc>::deallocate(allocator, buff_, capacity_);
+        }
+    }
+
+    // Exchanges the contents but not the allocators.
+    void SwapStorage(Buffer& other) noexcept {
+        std::swap(capacity_, other.capacity_);
+        std::swap(size_, other.size_);
+        std::swap(head_, other.head_);
+        std::swap(tail_, other.tail_);
+        std::swap(buff_, other.buff_);
+        std::swap(mapped_bytes_, other.mapped_bytes_);
+    }
+
+    void DestructElements() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for (iterator it = begin(); it != end(); ++it) {
+                std::allocator_traits<alloc>::destroy(allocator, &(*it));
+            }
+        }
+    }
 public:
     Buffer() = default;
 
-    explicit Buffer(const size_type capacity) :
-            capacity_(capacity + 1),
-            buff_(std::allocator_traits<alloc>::allocate(allocator, capacity)),
-            head_(Iter<value_type>(buff_, capacity + 1)),
-            tail_(++Iter<value_type>(buff_, capacity + 1)) {}
+    explicit Buffer(const alloc& buffer_allocator) : allocator(buffer_allocator) {}
+
+    explicit Buffer(const size_type capacity, const alloc& buffer_allocator = alloc()) :
+            capacity_(Slots(capacity)),
+            allocator(buffer_allocator),
+            buff_(std::allocator_traits<alloc>::allocate(allocator, capacity_)),
+            head_(iterator(buff_, capacity_)),
+            tail_(iterator(buff_, capacity_)) {}
 
-    Buffer(const std::initializer_list<T>& list) :
-            capacity_(list.size() + 1),
-            buff_(std::allocator_traits<alloc>::allocate(allocator, list.size() + 1)),
+    Buffer(const std::initializer_list<T>& list, const alloc& buffer_allocator = alloc()) :
+            capacity_(Slots(list.size())),
             size_(list.size()),
-            head_(Iter<value_type>(buff_, capacity_)),
+            allocator(buffer_allocator),
+            buff_(std::allocator_traits<alloc>::allocate(allocator, capacity_)),
+            head_(iterator(buff_, capacity_)),
             tail_(head_ + size_) {
         auto iter = list.begin();
         for (Buffer::iterator it = begin(); it != end(); ++it) {
@@ -219,36 +494,35 @@ public:
     }
 
     template<typename U>
-    Buffer(U begin, U end) : buff_(allocator.allocate(end - begin + 1)),
-                capacity_((end - begin) * kCapacityCoefficient + 1),
-                size_(end - begin),
-                head_(Iter<T>(&buff_[0], size_ + 1)),
-                tail_(Iter<T>(&buff_[0], size_ + 1)) {
+    Buffer(U begin, U end, const alloc& buffer_allocator = alloc()) : capacity_(Slots(end - begin)),
+                allocator(buffer_allocator),
+                buff_(std::allocator_traits<alloc>::allocate(allocator, capacity_)),
+                head_(iterator(buff_, capacity_)),
+                tail_(iterator(buff_, capacity_)) {
             for (U it = begin; it != end; ++it) {
                 push_back(*it);
             }
         }
 
-    Buffer(value_type k, size_type amount) :
-            capacity_(amount + 1),
-            buff_(std::allocator_traits<alloc>::allocate(allocator, capacity_)),
+    Buffer(value_type k, size_type amount, const alloc& buffer_allocator = alloc()) :
+            capacity_(Slots(amount)),
             size_(amount),
-            head_(Iter<value_type>(buff_, capacity_ + 1)),
+            allocator(buffer_allocator),
+            buff_(std::allocator_traits<alloc>::allocate(allocator, capacity_)),
+            head_(iterator(buff_, capacity_)),
             tail_(head_ + size_) {
         for (iterator iter = begin(); iter != end(); ++iter) {
             std::allocator_traits<alloc>::construct(allocator, &(*iter), k);
         }
     }
 
-    void DestructElements() {
-        for (iterator it = begin(); it != end(); ++it) {
-            std::allocator_traits<alloc>::destroy(allocator, &(*it));
-        }
-    }
-
     ~Buffer() {
         DestructElements();
-        std::allocator_traits<alloc>::deallocate(allocator, buff_, capacity_);
+        FreeStorage();
+    }
+
+    alloc get_allocator() const noexcept {
+        return allocator;
     }
 
     constexpr iterator begin() const noexcept {
@@ -269,7 +543,7 @@ public:
 
     constexpr reference operator[](const size_type n) {
         if (n < size_) {
-            return *begin()[n];
+            return begin()[n];
         } else {
             throw std::invalid_argument("Index is out of range");
         }
@@ -277,102 +551,277 @@ public:
 
     constexpr const_reference operator[](const size_type n) const {
         if (n < size_) {
-            return *begin()[n];
+            return begin()[n];
         } else {
             throw std::invalid_argument("Index is out of range");
         }
     }
 
-    Buffer(const Buffer& other) {
+    Buffer(const Buffer& other) :
+            allocator(std::allocator_traits<alloc>::select_on_container_copy_construction(other.allocator)) {
+        if (other.capacity_ == 0) {
+            return;
+        }
         capacity_ = other.capacity_;
-        size_ = other.size_;
         buff_ = std::allocator_traits<alloc>::allocate(allocator, other.capacity_);
-        head_ = Iter<T>(buff_, capacity_);
-        tail_ = head_ + size_;
-        iterator j = other.head_;
-        for (Buffer::iterator i = head_; i != tail_; ++i) {
-            std::allocator_traits<alloc>::construct(allocator, &(*i), *j);
-            ++j;
+        try {
+            RingCopyFront(allocator, buff_, capacity_, other.head_, other.size_);
+        } catch (...) {
+            FreeStorage();
+            throw;
         }
+        size_ = other.size_;
+        head_ = iterator(buff_, capacity_);
+        tail_ = head_ + size_;
     }
 
+    // Leaves `other` empty and without storage, like a default-constructed buffer.
+    Buffer(Buffer&& other) noexcept :
+            capacity_(std::exchange(other.capacity_, 0)),
+            size_(std::exchange(other.size_, 0)),
+            allocator(std::move(other.allocator)),
+            buff_(std::exchange(other.buff_, nullptr)),
+            head_(std::exchange(other.head_, iterator())),
+            tail_(std::exchange(other.tail_, iterator())),
+            mapped_bytes_(std::exchange(other.mapped_bytes_, 0)) {}
+
+    // Reuses the storage when it has as many slots as `other` and the allocator stays the same.
     Buffer& operator=(const Buffer& other) {
         if (this == &other) {
             return *this;
         }
-        allocator.deallocate(buff_, capacity_);
-        capacity_ = other.capacity_;
+        DestructElements();
+        size_ = 0;
+        tail_ = head_;
+        bool reuse = buff_ != nullptr && other.capacity_ != 0 && capacity_ == other.capacity_;
+        if constexpr (kPropagateOnCopy) {
+            reuse = reuse && allocator == other.allocator;
+        }
+        if (!reuse) {
+            FreeStorage();
+            buff_ = nullptr;
+            capacity_ = 0;
+            head_ = tail_ = iterator();
+            if constexpr (kPropagateOnCopy) {
+                allocator = other.allocator;
+            }
+            if (other.capacity_ == 0) {
+                return *this;
+            }
+            buff_ = std::allocator_traits<alloc>::allocate(allocator, other.capacity_);
+            capacity_ = other.capacity_;
+        }
+        head_ = iterator(buff_, capacity_);
+        tail_ = head_;
+        RingCopyFront(allocator, buff_, capacity_, other.head_, other.size_);
         size_ = other.size_;
-        buff_ = std::allocator_traits<alloc>::allocate(allocator, other.capacity_);
-        head_ = Iter<T>(buff_, capacity_);
         tail_ = head_ + size_;
-        iterator j = other.head_;
-        for (Buffer::iterator i = begin(); i != end(); ++i) {
-            std::allocator_traits<alloc>::construct(allocator, &(*i), *j);
-            ++j;
-        }
         return *this;
     }
 
-    constexpr bool operator==(Buffer& other) {
-        if (size_ != other.size_) {
-            return false;
-        } else {
-            iterator j = other.begin();
-            for (Buffer::const_iterator i = cbegin(); i < cend(); ++i) {
-                if (*i != *j) {
-                    return false;
+    // Takes over the storage of `other` when the allocators allow it; otherwise the elements are moved
+    // one by one into storage from this buffer's allocator.
+    Buffer& operator=(Buffer&& other) noexcept(kPropagateOnMove || kAllocatorsEqual) {
+        if (this != &other) {
+            if constexpr (!kPropagateOnMove && !kAllocatorsEqual) {
+                if (allocator != other.allocator) {
+                    // A source without storage has no capacity to recreate.
+                    Buffer moved = other.capacity_ == 0 ? Buffer(allocator) : Buffer(other.max_size(), allocator);
+                    for (iterator it = other.begin(); it != other.end(); ++it) {
+                        moved.emplace_back(std::move(*it));
+                    }
+                    SwapStorage(moved);
+                    return *this;
                 }
-                ++j;
             }
-            return true;
+            DestructElements();
+            FreeStorage();
+            if constexpr (kPropagateOnMove) {
+                allocator = std::move(other.allocator);
+            }
+            capacity_ = std::exchange(other.capacity_, 0);
+            size_ = std::exchange(other.size_, 0);
+            buff_ = std::exchange(other.buff_, nullptr);
+            head_ = std::exchange(other.head_, iterator());
+            tail_ = std::exchange(other.tail_, iterator());
+            mapped_bytes_ = std::exchange(other.mapped_bytes_, 0);
         }
+        return *this;
+    }
+
+    bool operator==(const Buffer& other) const {
+        return size_ == other.size_ && RingEqual(cbegin(), other.cbegin(), size_);
     }
 
-    constexpr bool operator!=(const Buffer& other) const noexcept {
+    bool operator!=(const Buffer& other) const {
         return !(*this == other);
     }
 
-    constexpr void push_back(const_reference n) noexcept {
-        if (size_ == 0) {
-            *head_ = n;
-            ++size_;
-        } else if (tail_ + 1 == head_) {
-            *tail_ = n;
-            ++tail_;
+    void push_back(const_reference n) {
+        emplace_back(n);
+    }
+
+    void push_back(value_type&& n) {
+        emplace_back(std::move(n));
+    }
+
+    // The new element goes into the spare slot behind the tail; when the buffer is full the oldest one
+    // is dropped afterwards, so the arguments may still refer to it.
+    template<typename... Args>
+    reference emplace_back(Args&&... args) {
+        if (capacity_ <= kSpareSlots) {
+            throw std::invalid_argument("The buffer has no capacity");
+        }
+        if constexpr (kSpareSlots == 0) {
+            // A full masked ring has no spare slot: the tail is the head, so the element is built aside
+            // before the oldest one goes.
+            if (size_ == capacity_) {
+                value_type value(std::forward<Args>(args)...);
+                pop_front();
+                return emplace_back(std::move(value));
+            }
+        }
+        std::allocator_traits<alloc>::construct(allocator, &(*tail_), std::forward<Args>(args)...);
+        reference element = *tail_;
+        ++tail_;
+        if (size_ == capacity_ - kSpareSlots) {
+            std::allocator_traits<alloc>::destroy(allocator, &(*head_));
             ++head_;
         } else {
-            *tail_ = n;
-            ++tail_;
             ++size_;
         }
+        return element;
     }
 
     void pop_front() {
         if (size_ == 0) {
             throw std::invalid_argument("The buffer is already empty");
         } else {
-            if (!(tail_ == head_ + 1 && size_ == 1)) {
-                ++head_;
-            }
+            std::allocator_traits<alloc>::destroy(allocator, &(*head_));
+            ++head_;
             --size_;
         }
     }
 
-    void swap(Buffer& other) {
-        std::swap(capacity_, other.capacity_);
-        std::swap(size_, other.size_);
-        std::swap(head_, other.head_);
-        std::swap(tail_, other.tail_);
-        std::swap(buff_, other.buff_);
+    // Appends the elements of [first, last), which must not overlap the buffer, dropping the oldest ones
+    // as needed: when the range alone does not fit, only its last max_size() elements are kept.
+    template<std::forward_iterator U>
+    void append(U first, U last) {
+        auto count = static_cast<size_type>(std::distance(first, last));
+        if (count == 0) {
+            return;
+        }
+        if (capacity_ <= kSpareSlots) {
+            throw std::invalid_argument("The buffer has no capacity");
+        }
+        const size_type room = capacity_ - kSpareSlots;
+        if (count > room) {
+            std::advance(first, count - room);
+            count = room;
+        }
+        if (size_ + count > room) {
+            pop_front(size_ + count - room);
+        }
+        RingConstruct(allocator, buff_, capacity_, SlotOf(tail_), first, count);
+        tail_ += static_cast<int64_t>(count);
+        size_ += count;
+    }
+
+    void push_back(std::span<const value_type> values) {
+        append(values.begin(), values.end());
+    }
+
+    void pop_front(size_type count) {
+        if (count > size_) {
+            throw std::invalid_argument("The buffer holds fewer elements");
+        }
+        if constexpr (!std::is_trivially_destructible_v<value_type>) {
+            const iterator last = head_ + static_cast<int64_t>(count);
+            for (iterator it = head_; it != last; ++it) {
+                std::allocator_traits<alloc>::destroy(allocator, &(*it));
+            }
+        }
+        head_ += static_cast<int64_t>(count);
+        size_ -= count;
+    }
+
+    // Moves the oldest elements into `out`, as many as fit, removes them and returns their number.
+    size_type read_into(std::span<value_type> out) {
+        const size_type count = std::min(out.size(), size_);
+        if (count != 0) {
+            RingMoveOut(allocator, buff_, capacity_, SlotOf(head_), out.data(), count);
+        }
+        head_ += static_cast<int64_t>(count);
+        size_ -= count;
+        return count;
+    }
+
+    // The elements in order as one or two contiguous pieces, e.g. for writev.
+    std::pair<std::span<value_type>, std::span<value_type>> as_spans() noexcept {
+        const size_type head = SlotOf(head_);
+        const size_type first = std::min(size_, capacity_ - head);
+        return {std::span<value_type>(buff_ + head, first), std::span<value_type>(buff_, size_ - first)};
+    }
+
+    std::pair<std::span<const value_type>, std::span<const value_type>> as_spans() const noexcept {
+        const size_type head = SlotOf(head_);
+        const size_type first = std::min(size_, capacity_ - head);
+        return {std::span<const value_type>(buff_ + head, first), std::span<const value_type>(buff_, size_ - first)};
     }
 
-    static void swap(Buffer& first, Buffer& second) {
-        std::swap(first.capacity_, second.capacity_);
-        std::swap(first.size_, second.size_);
-        std::swap(first.head_, second.head_);
-        std::swap(first.tail_, second.tail_);
-        std::swap(first.buff_, second.buff_);
+    // Writes the buffer to `path` as a snapshot (see Snapshot.h): a header, then the storage with every
+    // element in its slot.
+    void save(const std::string& path) const requires std::is_trivially_copyable_v<T> {
+        const auto [first, second] = as_spans();
+        SaveSnapshot(path, sizeof(T), capacity_, SlotOf(head_), std::as_bytes(first), std::as_bytes(second));
+    }
+
+    // Replaces the contents with a snapshot written by save(). LoadMode::Copy reads the elements into new
+    // storage and checks the checksum. LoadMode::Map makes a copy-on-write mapping of the file the storage,
+    // so loading takes the same time whatever the size and pages are only read when first touched; the
+    // checksum is not checked and changes are never written back to the file.
+    void load(const std::string& path, LoadMode mode = LoadMode::Copy) requires std::is_trivially_copyable_v<T> {
+        const SnapshotHeader header = ReadSnapshotHeader(path, sizeof(T));
+        if (header.slots != 0 && (header.slots != Slots(header.slots - kSpareSlots) || header.size > header.slots - kSpareSlots)) {
+            throw std::invalid_argument("The snapshot does not fit this buffer layout");
+        }
+        pointer storage = nullptr;
+        size_type mapped_bytes = 0;
+        if (header.slots != 0 && mode == LoadMode::Map) {
+            storage = reinterpret_cast<pointer>(MapSnapshot(path, header, mapped_bytes));
+        } else if (header.slots != 0) {
+            storage = std::allocator_traits<alloc>::allocate(allocator, header.slots);
+            try {
+                ReadSnapshotSlots(path, header, reinterpret_cast<std::byte*>(storage));
+            } catch (...) {
+                std::allocator_traits<alloc>::deallocate(allocator, storage, header.slots);
+                throw;
+            }
+        }
+        DestructElements();
+        FreeStorage();
+        capacity_ = header.slots;
+        size_ = header.size;
+        buff_ = storage;
+        mapped_bytes_ = mapped_bytes;
+        if (capacity_ == 0) {
+            head_ = tail_ = iterator();
+            return;
+        }
+        head_ = iterator(buff_, capacity_) + static_cast<int64_t>(header.head);
+        tail_ = head_ + size_;
+    }
+
+    // Allocators that do not propagate on swap must compare equal, as for the standard containers.
+    void swap(Buffer& other) noexcept {
+        if constexpr (kPropagateOnSwap) {
+            std::swap(allocator, other.allocator);
+        }
+        SwapStorage(other);
+    }
+
+    static void swap(Buffer& first, Buffer& second) noexcept {
+        first.swap(second);
     }
 
     size_type size() {
@@ -380,7 +829,7 @@ public:
     }
 
     size_type max_size() {
-        return capacity_ - 1;
+        return capacity_ == 0 ? 0 : capacity_ - kSpareSlots;
     }
 
     bool empty() {
@@ -388,11 +837,61 @@ public:
     }
 };
 
+template<typename T, typename alloc = std::allocator<T>>
+using MaskedBuffer = Buffer<T, alloc, PowerOfTwoCapacity>;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////        CCircularBufferExt class       ///////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-template<typename T, typename alloc = std::allocator<T>>
+// Growth policies of ExtBuffer. A policy gets the current capacity and the capacity that is needed
+// and returns the capacity to grow to; anything below the needed one is raised to it.
+
+template<size_t Numerator, size_t Denominator = 1>
+struct FactorGrowth {
+    static_assert(Numerator > Denominator, "the growth factor must be above one");
+
+    constexpr size_t operator()(size_t capacity, size_t required) const noexcept {
+        return std::max(capacity / Denominator * Numerator + capacity % Denominator * Numerator / Denominator, required);
+    }
+};
+
+template<size_t Step>
+struct AdditiveGrowth {
+    static_assert(Step > 0, "the growth step must be positive");
+
+    constexpr size_t operator()(size_t capacity, size_t required) const noexcept {
+        return std::max(capacity + Step, required);
+    }
+};
+
+// Any `size_t(size_t capacity, size_t required)` function, e.g. CallbackGrowth<&MyGrowth>.
+template<auto Callback>
+struct CallbackGrowth {
+    constexpr size_t operator()(size_t capacity, size_t required) const {
+        return std::max(static_cast<size_t>(Callback(capacity, required)), required);
+    }
+};
+
+template<typename G>
+concept GrowthPolicy = std::default_initializable<G> && requires(const G& growth, size_t capacity) {
+    { growth(capacity, capacity) } -> std::convertible_to<size_t>;
+};
+
+// Types whose objects may be moved to another address by copying their bytes, without running the move
+// constructor and the destructor. Trivially copyable types qualify; specialize it for other types that do
+// not point into themselves (e.g. most owning handles) to get the same fast relocation.
+template<typename T>
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template<typename T>
+inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+// Buffers of at least this many bytes that use the default allocator live in their own memory mapping
+// (on Linux), so that growing them remaps pages instead of copying the data.
+inline constexpr size_t kMappedBufferBytes = size_t(1) << 25;
+
+template<typename T, typename alloc = std::allocator<T>, GrowthPolicy Growth = FactorGrowth<kCapacityCoefficient>>
 
 class ExtBuffer {
 public:
@@ -406,23 +905,270 @@ public:
 private:
     size_type capacity_ = 0;
     size_type size_ = 0;
-    alloc allocator;
-    pointer buff_;
+    [[no_unique_address]] alloc allocator;
+    pointer buff_ = nullptr;
     iterator head_;
     iterator tail_;
+    // Length of the snapshot mapping that holds the storage after load(path, LoadMode::Map), 0 while the
+    // storage comes from the allocator.
+    size_type mapped_bytes_ = 0;
+
+    static constexpr bool kPropagateOnCopy = std::allocator_traits<alloc>::propagate_on_container_copy_assignment::value;
+    static constexpr bool kPropagateOnMove = std::allocator_traits<alloc>::propagate_on_container_move_assignment::value;
+    static constexpr bool kPropagateOnSwap = std::allocator_traits<alloc>::propagate_on_container_swap::value;
+    static constexpr bool kAllocatorsEqual = std::allocator_traits<alloc>::is_always_equal::value;
+
+    // Exchanges the contents but not the allocators.
+    void SwapStorage(ExtBuffer& other) noexcept {
+        std::swap(capacity_, other.capacity_);
+        std::swap(size_, other.size_);
+        std::swap(head_, other.head_);
+        std::swap(tail_, other.tail_);
+        std::swap(buff_, other.buff_);
+        std::swap(mapped_bytes_, other.mapped_bytes_);
+    }
+
+    void DestructElements() {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            for (iterator it = begin(); it != end(); ++it) {
+                std::allocator_traits<alloc>::destroy(allocator, &(*it));
+            }
+        }
+    }
+
+    static constexpr bool kBitwiseRelocation = is_trivially_relocatable_v<T>;
+
+#if defined(__linux__)
+    static constexpr bool kMappedStorage = kBitwiseRelocation && std::is_same_v<alloc, std::allocator<T>>;
+#else
+    static constexpr bool kMappedStorage = false;
+#endif
+
+    static size_type MappedBytes(size_type capacity) {
+        const size_type page = 4096;
+        return (capacity * sizeof(T) + page - 1) / page * page;
+    }
+
+    static bool Mapped(size_type capacity) {
+        return kMappedStorage && capacity * sizeof(T) >= kMappedBufferBytes;
+    }
+
+    pointer Allocate(size_type capacity) {
+#if defined(__linux__)
+        if (Mapped(capacity)) {
+            void* memory = mmap(nullptr, MappedBytes(capacity), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            return static_cast<pointer>(memory);
+        }
+#endif
+        return std::allocator_traits<alloc>::allocate(allocator, capacity);
+    }
+
+    void Deallocate(pointer buffer, size_type capacity) {
+        if (buffer == nullptr) {
+            return;
+        }
+        if (mapped_bytes_ != 0 && buffer == buff_) {
+            UnmapSnapshot(reinterpret_cast<std::byte*>(buffer), std::exchange(mapped_bytes_, 0));
+            return;
+        }
+#if defined(__linux__)
+        if (Mapped(capacity)) {
+            munmap(buffer, MappedBytes(capacity));
+            return;
+        }
+#endif
+        std::allocator_traits<alloc>::deallocate(allocator, buffer, capacity);
+    }
+
+    // Number of ring slots to grow to so that `required` elements fit.
+    size_type GrownCapacity(size_type required) const {
+        const size_type current = capacity_ == 0 ? 0 : capacity_ - 1;
+        return static_cast<size_type>(Growth{}(current, required)) + 1;
+    }
+
+    // The elements as at most two contiguous pieces: from the head to the end of the storage, then from
+    // the start of the storage.
+    std::pair<size_type, size_type> Segments() const {
+        if (size_ == 0) {
+            return {0, 0};
+        }
+        const auto head = static_cast<size_type>(&(*head_) - buff_);
+        const size_type first = std::min(size_, capacity_ - head);
+        return {first, size_ - first};
+    }
+
+    // Moves the elements to the front of `buffer`. Bitwise-relocatable elements are copied with at most
+    // two memcpy calls. Others are moved when that cannot throw and copied otherwise, so a failure leaves
+    // this buffer untouched (the partial copies are destroyed before rethrowing).
+    void RelocateInto(pointer buffer) {
+        if constexpr (kBitwiseRelocation) {
+            const auto [first, second] = Segments();
+            if (first != 0) {
+                std::memcpy(static_cast<void*>(buffer), static_cast<const void*>(&(*head_)), first * sizeof(T));
+            }
+            if (second != 0) {
+                std::memcpy(static_cast<void*>(buffer + first), static_cast<const void*>(buff_), second * sizeof(T));
+            }
+            return;
+        }
+        size_type done = 0;
+        try {
+            for (iterator it = begin(); it != end(); ++it, ++done) {
+                std::allocator_traits<alloc>::construct(allocator, buffer + done, std::move_if_noexcept(*it));
+            }
+        } catch (...) {
+            std::destroy_n(buffer, done);
+            throw;
+        }
+    }
+
+    // Destroys the current elements and switches to `buffer`, whose first `size` slots hold the elements.
+    void AdoptStorage(pointer buffer, size_type capacity, size_type size) {
+        if constexpr (!kBitwiseRelocation) {
+            DestructElements();
+        }
+        Deallocate(buff_, capacity_);
+        buff_ = buffer;
+        capacity_ = capacity;
+        size_ = size;
+        head_ = Iter<T>(buff_, capacity_);
+        tail_ = head_ + size_;
+    }
+
+    // Grows a mapped buffer in place with mremap, which moves pages instead of bytes. Only the part of the
+    // ring that wrapped around to the start of the storage is copied, to follow the rest.
+    bool Remap(size_type capacity) {
+#if defined(__linux__)
+        if (mapped_bytes_ != 0 || !Mapped(capacity_) || !Mapped(capacity) || capacity < capacity_) {
+            return false;
+        }
+        const auto [first, second] = Segments();
+        const auto head = size_ == 0 ? 0 : static_cast<size_type>(&(*head_) - buff_);
+        void* memory = mremap(buff_, MappedBytes(capacity_), MappedBytes(capacity), MREMAP_MAYMOVE);
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        pointer buffer = static_cast<pointer>(memory);
+        const size_type room = std::min(second, capacity - capacity_);
+        std::memcpy(static_cast<void*>(buffer + capacity_), static_cast<const void*>(buffer), room * sizeof(T));
+        std::memmove(static_cast<void*>(buffer), static_cast<const void*>(buffer + room), (second - room) * sizeof(T));
+        buff_ = buffer;
+        capacity_ = capacity;
+        head_ = Iter<T>(buff_, buff_ + head, capacity_);
+        tail_ = head_ + size_;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Inserts `count` elements, source(0) ... source(count - 1), before the element at `position`. Grows at
+    // most once, then shifts the shorter side of the buffer outwards to open the gap. Slots that held an
+    // element before are assigned to, the others are constructed. head_, tail_ and size_ only change once
+    // every slot is filled; if a move or source(i) throws, the slots constructed so far are destroyed and
+    // the buffer keeps its elements, some of which may have been moved from.
+    template<typename Source>
+    iterator InsertN(size_type position, size_type count, Source source) {
+        if (position > size_) {
+            throw std::invalid_argument("Index out of range");
+        }
+        // Nothing to open: shifting by zero would move every element onto itself.
+        if (count == 0) {
+            return head_ + static_cast<int64_t>(position);
+        }
+        if (size_ + count + 1 > capacity_) {
+            Reallocate(GrownCapacity(size_ + count));
+        }
+        const bool front = position < size_ - position;
+        const iterator first = front ? head_ - static_cast<int64_t>(count) : head_;
+        // New slots constructed by the shift and by the gap fill. Each phase constructs one contiguous run
+        // of them, so the two counts are enough to find them again.
+        size_type shifted = 0;
+        size_type filled = 0;
+        size_type* built = &shifted;
+        auto put = [&](iterator slot, auto&& value) {
+            if (slot >= head_ && slot < tail_) {
+                *slot = std::forward<decltype(value)>(value);
+            } else {
+                std::allocator_traits<alloc>::construct(allocator, &(*slot), std::forward<decltype(value)>(value));
+                ++*built;
+            }
+        };
+        const iterator gap = first + static_cast<int64_t>(position);
+        try {
+            if (front) {
+                for (size_type i = 0; i < position; ++i) {
+                    put(first + i, std::move(head_[i]));
+                }
+            } else {
+                for (size_type i = size_; i-- > position;) {
+                    put(head_ + (i + count), std::move(head_[i]));
+                }
+            }
+            built = &filled;
+            for (size_type i = 0; i < count; ++i) {
+                put(gap + i, source(i));
+            }
+        } catch (...) {
+            auto destroy = [&](iterator from, size_type n) {
+                for (size_type i = 0; i < n; ++i) {
+                    std::allocator_traits<alloc>::destroy(allocator, &(*(from + i)));
+                }
+            };
+            if (front) {
+                destroy(first, shifted);
+                destroy(gap, filled);
+            } else {
+                destroy(tail_ + static_cast<int64_t>(count - shifted), shifted);
+                destroy(tail_, filled);
+            }
+            throw;
+        }
+        if (front) {
+            head_ = first;
+        } else {
+            tail_ += static_cast<int64_t>(count);
+        }
+        size_ += count;
+        return gap;
+    }
+
+    // Moves the elements to storage with `capacity` ring slots.
+    void Reallocate(size_type capacity) {
+        if constexpr (kMappedStorage) {
+            if (Remap(capacity)) {
+                return;
+            }
+        }
+        pointer buffer = Allocate(capacity);
+        try {
+            RelocateInto(buffer);
+        } catch (...) {
+            Deallocate(buffer, capacity);
+            throw;
+        }
+        AdoptStorage(buffer, capacity, size_);
+    }
 public:
     ExtBuffer() = default;
 
-    explicit ExtBuffer(const size_type capacity) :
+    explicit ExtBuffer(const alloc& buffer_allocator) : allocator(buffer_allocator) {}
+
+    explicit ExtBuffer(const size_type capacity, const alloc& buffer_allocator = alloc()) :
             capacity_(capacity + 1),
-            buff_(std::allocator_traits<alloc>::allocate(allocator, capacity)),
+            allocator(buffer_allocator),
+            buff_(Allocate(capacity_)),
             head_(Iter<value_type>(buff_, capacity + 1)),
-            tail_(++Iter<value_type>(buff_, capacity + 1)) {}
+            tail_(Iter<value_type>(buff_, capacity + 1)) {}
 
-    ExtBuffer(const std::initializer_list<T>& list) :
+    ExtBuffer(const std::initializer_list<T>& list, const alloc& buffer_allocator = alloc()) :
             capacity_(list.size() * kCapacityCoefficient + 1),
-            buff_(std::allocator_traits<alloc>::allocate(allocator, capacity_)),
             size_(list.size()),
+            allocator(buffer_allocator),
+            buff_(Allocate(capacity_)),
             head_(Iter<value_type>(buff_, capacity_)),
             tail_(head_ + size_) {
         auto iter = list.begin();
@@ -432,11 +1178,12 @@ public:
         }
     }
 
-    ExtBuffer(value_type k, size_type amount) :
+    ExtBuffer(value_type k, size_type amount, const alloc& buffer_allocator = alloc()) :
             capacity_(amount * kCapacityCoefficient + 1),
-            buff_(std::allocator_traits<alloc>::allocate(allocator, capacity_)),
             size_(amount),
-            head_(Iter<value_type>(buff_, capacity_ + 1)),
+            allocator(buffer_allocator),
+            buff_(Allocate(capacity_)),
+            head_(Iter<value_type>(buff_, capacity_)),
             tail_(head_ + size_) {
         for (iterator iter = begin(); iter != end(); ++iter) {
             std::allocator_traits<alloc>::construct(allocator, &(*iter), k);
@@ -444,24 +1191,24 @@ public:
     }
 
     template<typename U>
-    ExtBuffer(U begin, U end) : buff_(allocator.allocate(end - begin + 1)),
-              size_(end - begin),
-              capacity_((end - begin) * kCapacityCoefficient + 1),
-              head_(Iter<T>(&buff_[0], size_ + 1)),
-              tail_(Iter<T>(&buff_[0], size_ + 1)) {
+    ExtBuffer(U begin, U end, const alloc& buffer_allocator = alloc()) : capacity_((end - begin) * kCapacityCoefficient + 1),
+              allocator(buffer_allocator),
+              buff_(Allocate(capacity_)),
+              head_(Iter<T>(buff_, capacity_)),
+              tail_(Iter<T>(buff_, capacity_)) {
         for (U it = begin; it != end; ++it) {
             push_back(*it);
         }
     }
 
-    ExtBuffer(iterator it1, iterator it2) {
+    ExtBuffer(iterator it1, iterator it2, const alloc& buffer_allocator = alloc()) : allocator(buffer_allocator) {
         size_type capacity = 0;
         for (iterator iter = it1; iter != it2; ++iter) {
             ++capacity;
         }
         size_ = capacity;
         capacity_ = capacity * kCapacityCoefficient + 1;
-        buff_ = std::allocator_traits<alloc>::allocate(allocator, capacity_);
+        buff_ = Allocate(capacity_);
         head_ = Iter<value_type>(buff_, capacity_);
         tail_ = head_ + size_;
         for (iterator it = it1, other_iter = begin(); it != it2; ++it, ++other_iter) {
@@ -469,20 +1216,18 @@ public:
         }
     }
 
-    void DestructElements() {
-        for (iterator it = begin(); it != end(); ++it) {
-            std::allocator_traits<alloc>::destroy(allocator, &(*it));
-        }
-    }
-
     ~ExtBuffer() {
         DestructElements();
-        std::allocator_traits<alloc>::deallocate(allocator, buff_, capacity_);
+        Deallocate(buff_, capacity_);
+    }
+
+    alloc get_allocator() const noexcept {
+        return allocator;
     }
 
     constexpr reference operator[](const size_type n) {
         if (n < size_) {
-            return *begin()[n];
+            return begin()[n];
         } else {
             throw std::invalid_argument("Index is out of range");
         }
@@ -490,7 +1235,7 @@ public:
 
     constexpr const_reference operator[](const size_type n) const {
         if (n < size_) {
-            return *begin()[n];
+            return begin()[n];
         } else {
             throw std::invalid_argument("Index is out of range");
         }
@@ -512,329 +1257,390 @@ public:
         return tail_.MakeConst();
     }
 
-    ExtBuffer(const ExtBuffer& other) {
+    ExtBuffer(const ExtBuffer& other) :
+            allocator(std::allocator_traits<alloc>::select_on_container_copy_construction(other.allocator)) {
+        if (other.capacity_ == 0) {
+            return;
+        }
         capacity_ = other.capacity_;
+        buff_ = Allocate(other.capacity_);
+        try {
+            RingCopyFront(allocator, buff_, capacity_, other.head_, other.size_);
+        } catch (...) {
+            Deallocate(buff_, capacity_);
+            throw;
+        }
         size_ = other.size_;
-        buff_ = std::allocator_traits<alloc>::allocate(allocator, other.capacity_);
         head_ = Iter<T>(buff_, capacity_);
         tail_ = head_ + size_;
-        iterator j = other.head_;
-        for (ExtBuffer::iterator i = begin(); i != end(); ++i) {
-            std::allocator_traits<alloc>::construct(allocator, &(*i), *j);
-            ++j;
-        }
     }
 
+    // Leaves `other` empty and without storage, like a default-constructed buffer.
+    ExtBuffer(ExtBuffer&& other) noexcept :
+            capacity_(std::exchange(other.capacity_, 0)),
+            size_(std::exchange(other.size_, 0)),
+            allocator(std::move(other.allocator)),
+            buff_(std::exchange(other.buff_, nullptr)),
+            head_(std::exchange(other.head_, iterator())),
+            tail_(std::exchange(other.tail_, iterator())),
+            mapped_bytes_(std::exchange(other.mapped_bytes_, 0)) {}
+
+    // Reuses the storage when the elements of `other` fit and the allocator stays the same.
     ExtBuffer& operator=(const ExtBuffer& other) {
         if (this == &other) {
             return *this;
         }
-        allocator.deallocate(buff_, capacity_);
-        capacity_ = other.capacity_;
-        size_ = other.size_;
-        buff_ = std::allocator_traits<alloc>::allocate(allocator, other.capacity_);
+        DestructElements();
+        size_ = 0;
+        tail_ = head_;
+        bool reuse = buff_ != nullptr && capacity_ > other.size_;
+        if constexpr (kPropagateOnCopy) {
+            reuse = reuse && allocator == other.allocator;
+        }
+        if (!reuse) {
+            Deallocate(buff_, capacity_);
+            buff_ = nullptr;
+            capacity_ = 0;
+            head_ = tail_ = iterator();
+            if constexpr (kPropagateOnCopy) {
+                allocator = other.allocator;
+            }
+            if (other.capacity_ == 0) {
+                return *this;
+            }
+            buff_ = Allocate(other.capacity_);
+            capacity_ = other.capacity_;
+        }
         head_ = Iter<T>(buff_, capacity_);
+        tail_ = head_;
+        RingCopyFront(allocator, buff_, capacity_, other.head_, other.size_);
+        size_ = other.size_;
         tail_ = head_ + size_;
-        iterator j = other.head_;
-        for (ExtBuffer::iterator i = begin(); i != end(); ++i) {
-            std::allocator_traits<alloc>::construct(allocator, &(*i), *j);
-            ++j;
-        }
         return *this;
     }
 
-    constexpr bool operator==(ExtBuffer& other) {
-        if (size_ != other.size_) {
-            return false;
-        } else {
-            iterator j = other.begin();
-            for (ExtBuffer::const_iterator i = cbegin(); i < cend(); ++i) {
-                if (*i != *j) {
-                    return false;
+    // Takes over the storage of `other` when the allocators allow it; otherwise the elements are moved
+    // one by one into storage from this buffer's allocator.
+    ExtBuffer& operator=(ExtBuffer&& other) noexcept(kPropagateOnMove || kAllocatorsEqual) {
+        if (this != &other) {
+            if constexpr (!kPropagateOnMove && !kAllocatorsEqual) {
+                if (allocator != other.allocator) {
+                    ExtBuffer moved(other.size_, allocator);
+                    for (iterator it = other.begin(); it != other.end(); ++it) {
+                        moved.emplace_back(std::move(*it));
+                    }
+                    SwapStorage(moved);
+                    return *this;
                 }
-                ++j;
             }
-            return true;
+            DestructElements();
+            Deallocate(buff_, capacity_);
+            if constexpr (kPropagateOnMove) {
+                allocator = std::move(other.allocator);
+            }
+            capacity_ = std::exchange(other.capacity_, 0);
+            size_ = std::exchange(other.size_, 0);
+            buff_ = std::exchange(other.buff_, nullptr);
+            head_ = std::exchange(other.head_, iterator());
+            tail_ = std::exchange(other.tail_, iterator());
+            mapped_bytes_ = std::exchange(other.mapped_bytes_, 0);
         }
+        return *this;
+    }
+
+    bool operator==(const ExtBuffer& other) const {
+        return size_ == other.size_ && RingEqual(cbegin(), other.cbegin(), size_);
     }
 
-    constexpr bool operator!=(const ExtBuffer& other) {
+    bool operator!=(const ExtBuffer& other) const {
         return !(*this == other);
     }
 
     void push_back(const_reference n) {
-        if (size_ == 0) {
-            *head_ = n;
-            ++size_;
-        } else if (size_ == capacity_ - 1) {
-            pointer new_buffer = std::allocator_traits<alloc>::allocate(allocator, capacity_ * kCapacityCoefficient + 1);
-            size_t current_position = 0;
-            for (iterator it = begin(); it != end(); ++it, ++current_position) {
-                std::allocator_traits<alloc>::construct(allocator, new_buffer + current_position, *it);
-            }
-            allocator.deallocate(buff_, capacity_);
-            capacity_ = capacity_ * kCapacityCoefficient;
-            buff_ = std::move(new_buffer);
-            head_ = Iter<T>(buff_, capacity_);
-            tail_ = head_ + current_position;
-            *tail_ = n;
+        emplace_back(n);
+    }
+
+    void push_back(value_type&& n) {
+        emplace_back(std::move(n));
+    }
+
+    template<typename... Args>
+    reference emplace_back(Args&&... args) {
+        if (size_ + 1 < capacity_) {
+            std::allocator_traits<alloc>::construct(allocator, &(*tail_), std::forward<Args>(args)...);
             ++tail_;
             ++size_;
-        } else {
-            *tail_ = n;
+            return *(tail_ - 1);
+        }
+        const size_type capacity = GrownCapacity(size_ + 1);
+        if constexpr (kBitwiseRelocation) {
+            // Relocation is a memcpy or a remap, so build the element first in case the arguments refer
+            // to elements of this buffer.
+            value_type value(std::forward<Args>(args)...);
+            Reallocate(capacity);
+            std::allocator_traits<alloc>::construct(allocator, &(*tail_), std::move(value));
             ++tail_;
             ++size_;
+            return *(tail_ - 1);
         }
+        // The new element is built in the new storage before the old ones leave theirs, so the arguments
+        // may refer to elements of this buffer.
+        pointer buffer = Allocate(capacity);
+        try {
+            std::allocator_traits<alloc>::construct(allocator, buffer + size_, std::forward<Args>(args)...);
+        } catch (...) {
+            Deallocate(buffer, capacity);
+            throw;
+        }
+        try {
+            RelocateInto(buffer);
+        } catch (...) {
+            std::allocator_traits<alloc>::destroy(allocator, buffer + size_);
+            Deallocate(buffer, capacity);
+            throw;
+        }
+        AdoptStorage(buffer, capacity, size_ + 1);
+        return buffer[size_ - 1];
     }
 
-    constexpr void pop_front() {
+    void pop_front() {
         if (size_ == 0) {
             throw std::invalid_argument("The buffer is already empty");
-        } else if (tail_ == head_ + 1 && size_ == 1) {
-            --size_;
         } else {
+            std::allocator_traits<alloc>::destroy(allocator, &(*head_));
             ++head_;
             --size_;
         }
     }
 
+    // Appends the elements of [first, last), which must not overlap the buffer, growing at most once.
+    template<std::forward_iterator U>
+    void append(U first, U last) {
+        const auto count = static_cast<size_type>(std::distance(first, last));
+        if (count == 0) {
+            return;
+        }
+        if (size_ + count + 1 > capacity_) {
+            Reallocate(GrownCapacity(size_ + count));
+        }
+        RingConstruct(allocator, buff_, capacity_, static_cast<size_type>(&(*tail_) - buff_), first, count);
+        tail_ += static_cast<int64_t>(count);
+        size_ += count;
+    }
+
+    void push_back(std::span<const value_type> values) {
+        append(values.begin(), values.end());
+    }
+
+    void pop_front(size_type count) {
+        if (count > size_) {
+            throw std::invalid_argument("The buffer holds fewer elements");
+        }
+        if constexpr (!std::is_trivially_destructible_v<value_type>) {
+            const iterator last = head_ + static_cast<int64_t>(count);
+            for (iterator it = head_; it != last; ++it) {
+                std::allocator_traits<alloc>::destroy(allocator, &(*it));
+            }
+        }
+        head_ += static_cast<int64_t>(count);
+        size_ -= count;
+    }
+
+    // Moves the oldest elements into `out`, as many as fit, removes them and returns their number.
+    size_type read_into(std::span<value_type> out) {
+        const size_type count = std::min(out.size(), size_);
+        if (count != 0) {
+            RingMoveOut(allocator, buff_, capacity_, static_cast<size_type>(&(*head_) - buff_), out.data(), count);
+        }
+        head_ += static_cast<int64_t>(count);
+        size_ -= count;
+        return count;
+    }
+
+    // The elements in order as one or two contiguous pieces, e.g. for writev.
+    std::pair<std::span<value_type>, std::span<value_type>> as_spans() noexcept {
+        const auto [first, second] = Segments();
+        return {std::span<value_type>(first == 0 ? buff_ : &(*head_), first), std::span<value_type>(buff_, second)};
+    }
+
+    std::pair<std::span<const value_type>, std::span<const value_type>> as_spans() const noexcept {
+        const auto [first, second] = Segments();
+        return {std::span<const value_type>(first == 0 ? buff_ : &(*head_), first), std::span<const value_type>(buff_, second)};
+    }
+
+    // Writes the buffer to `path` as a snapshot; see Buffer::save.
+    void save(const std::string& path) const requires std::is_trivially_copyable_v<T> {
+        const auto [first, second] = as_spans();
+        const auto head = size_ == 0 ? 0 : static_cast<size_type>(&(*head_) - buff_);
+        SaveSnapshot(path, sizeof(T), capacity_, head, std::as_bytes(first), std::as_bytes(second));
+    }
+
+    // Replaces the contents with a snapshot; see Buffer::load. A mapped snapshot stays the storage until
+    // the buffer grows, which moves the elements to allocated storage as usual.
+    void load(const std::string& path, LoadMode mode = LoadMode::Copy) requires std::is_trivially_copyable_v<T> {
+        const SnapshotHeader header = ReadSnapshotHeader(path, sizeof(T));
+        if (header.slots != 0 && header.size > header.slots - 1) {
+            throw std::invalid_argument("The snapshot does not fit this buffer layout");
+        }
+        pointer storage = nullptr;
+        size_type mapped_bytes = 0;
+        if (header.slots != 0 && mode == LoadMode::Map) {
+            storage = reinterpret_cast<pointer>(MapSnapshot(path, header, mapped_bytes));
+        } else if (header.slots != 0) {
+            storage = Allocate(header.slots);
+            try {
+                ReadSnapshotSlots(path, header, reinterpret_cast<std::byte*>(storage));
+            } catch (...) {
+                Deallocate(storage, header.slots);
+                throw;
+            }
+        }
+        DestructElements();
+        Deallocate(buff_, capacity_);
+        capacity_ = header.slots;
+        size_ = header.size;
+        buff_ = storage;
+        mapped_bytes_ = mapped_bytes;
+        if (capacity_ == 0) {
+            head_ = tail_ = iterator();
+            return;
+        }
+        head_ = Iter<T>(buff_, buff_ + header.head, capacity_);
+        tail_ = head_ + size_;
+    }
+
+    // Removes [first, last) by shifting the shorter of the two sides over the hole, so no memory is
+    // allocated and at most half of the elements move. Returns the iterator to the element after the
+    // removed ones.
+    iterator erase(iterator first, iterator last) {
+        const auto count = last - first;
+        if (count <= 0) {
+            return last;
+        }
+        if (first - head_ < tail_ - last) {
+            iterator kept = std::move_backward(head_, first, last);
+            for (iterator it = head_; it != kept; ++it) {
+                std::allocator_traits<alloc>::destroy(allocator, &(*it));
+            }
+            head_ = kept;
+            size_ -= count;
+            return last;
+        }
+        iterator kept = std::move(last, tail_, first);
+        for (iterator it = kept; it != tail_; ++it) {
+            std::allocator_traits<alloc>::destroy(allocator, &(*it));
+        }
+        tail_ = kept;
+        size_ -= count;
+        return first;
+    }
+
     void erase(size_type index) {
         if (size_ == 0 || index >= size_) {
             throw std::invalid_argument("erase in empty container");
-        } else {
-            pointer new_buffer = std::allocator_traits<alloc>::allocate(allocator, capacity_);
-            size_type current_position = 0;
-            for (iterator it = begin(); it != end(); ++it) {
-                if (it != begin()[index]) {
-                    std::allocator_traits<alloc>::construct(allocator, new_buffer + current_position, *it);
-                    ++current_position;
-                }
-            }
-            --size_;
-            DestructElements();
-            std::allocator_traits<alloc>::deallocate(allocator, buff_, capacity_);
-            buff_ = std::move(new_buffer);
-            head_ = Iter<T>(buff_, size_);
-            tail_ = head_ + current_position;
         }
+        erase(head_ + index, head_ + index + 1);
+    }
+
+    // Removes every element that satisfies the predicate in one compaction pass and returns their number.
+    template<typename Predicate>
+    size_type erase_if(Predicate predicate) {
+        iterator kept = std::remove_if(head_, tail_, predicate);
+        const auto removed = static_cast<size_type>(tail_ - kept);
+        for (iterator it = kept; it != tail_; ++it) {
+            std::allocator_traits<alloc>::destroy(allocator, &(*it));
+        }
+        tail_ = kept;
+        size_ -= removed;
+        return removed;
     }
 
+    // The range may come from this buffer: the copy is made before the old elements go.
     void assign(iterator it1, iterator it2) {
-        allocator.deallocate(buff_, capacity_);
-        size_type capacity = 0;
-        for (iterator it = it1; it != it2; ++it) {
-            ++capacity;
+        const auto count = static_cast<size_type>(it2 - it1);
+        const size_type capacity = count * kCapacityCoefficient + 1;
+        pointer buffer = Allocate(capacity);
+        try {
+            RingCopyFront(allocator, buffer, capacity, it1, count);
+        } catch (...) {
+            Deallocate(buffer, capacity);
+            throw;
         }
-        size_ = capacity;
-        capacity_ = capacity * kCapacityCoefficient + 1;
-        buff_ = std::allocator_traits<alloc>::allocate(allocator, capacity_);
+        DestructElements();
+        Deallocate(buff_, capacity_);
+        buff_ = buffer;
+        capacity_ = capacity;
+        size_ = count;
         head_ = Iter<T>(buff_, capacity_);
         tail_ = head_ + size_;
-        for (iterator it = it1, other_iter = begin(); it != it2; ++it, ++other_iter) {
-            std::allocator_traits<alloc>::construct(allocator, &(*other_iter), *it);
-        }
     }
 
     void assign(value_type k, size_type amount) {
-        allocator.deallocate(buff_, capacity_);
-        capacity_ = amount * kCapacityCoefficient + 1;
-        size_ = amount;
-        buff_ = std::allocator_traits<alloc>::allocate(allocator, capacity_);
-        head_ = Iter<T>(buff_, capacity_);
-        tail_ = head_ + size_;
-        for (iterator it = begin(); it != end(); ++it) {
-            std::allocator_traits<alloc>::construct(allocator, &(*it), k);
+        DestructElements();
+        Deallocate(buff_, capacity_);
+        buff_ = nullptr;
+        capacity_ = 0;
+        size_ = 0;
+        head_ = tail_ = iterator();
+        const size_type capacity = amount * kCapacityCoefficient + 1;
+        buff_ = Allocate(capacity);
+        capacity_ = capacity;
+        head_ = tail_ = Iter<T>(buff_, capacity_);
+        // The size grows with every element, so a throwing copy leaves the ones made so far.
+        for (size_type i = 0; i < amount; ++i) {
+            std::allocator_traits<alloc>::construct(allocator, &(*tail_), k);
+            ++tail_;
+            ++size_;
         }
     }
 
     void assign(const std::initializer_list<T>& il) {
-        allocator.deallocate(buff_, capacity_);
-        capacity_ = il.size() + kCapacityCoefficient + 1;
+        DestructElements();
+        Deallocate(buff_, capacity_);
+        buff_ = nullptr;
+        capacity_ = 0;
+        size_ = 0;
+        head_ = tail_ = iterator();
+        const size_type capacity = il.size() + kCapacityCoefficient + 1;
+        buff_ = Allocate(capacity);
+        capacity_ = capacity;
+        head_ = tail_ = Iter<T>(buff_, capacity_);
+        RingConstruct(allocator, buff_, capacity_, 0, il.begin(), il.size());
         size_ = il.size();
-        buff_ = std::allocator_traits<alloc>::allocate(allocator, capacity_);
-        head_ = Iter<T>(buff_, capacity_);
         tail_ = head_ + size_;
-        iterator it1 = begin();
-        for (auto it = il.begin(); it != il.end(); ++it) {
-            std::allocator_traits<alloc>::construct(allocator, &(*it1), *it);
-            ++it1;
-        }
     }
 
     iterator insert(size_type position, value_type k) {
-        if (position >= size_) {
-            throw std::invalid_argument("Index out of range");
-        }
-        if (size_ == capacity_ - 1) {
-            size_type new_capacity = capacity_ * kCapacityCoefficient + 1;
-            pointer new_buff = allocator.allocate(capacity_);
-            size_type current_index = 0;
-            iterator iter = begin();
-            while (iter != end()) {
-                if (current_index == position) {
-                    std::allocator_traits<alloc>::construct(allocator, new_buff + current_index, k);
-                    ++current_index;
-                } else {
-                    std::allocator_traits<alloc>::construct(allocator, new_buff + current_index, *iter);
-                    ++current_index;
-                    ++iter;
-                }
-            }
-            DestructElements();
-            std::allocator_traits<alloc>::deallocate(allocator, buff_, capacity_);
-            buff_ = std::move(new_buff);
-            capacity_ = new_capacity;
-            ++size_;
-            head_ = Iter<T>(buff_, capacity_);
-            tail_ = head_ + size_;
-        } else {
-            pointer new_buff = std::allocator_traits<alloc>::allocate(allocator, capacity_);
-            size_type current_index = 0;
-            iterator iter = begin();
-            while (iter != end()) {
-                if (current_index == position) {
-                    std::allocator_traits<alloc>::construct(allocator, new_buff + current_index, k);
-                    ++current_index;
-                } else {
-                    std::allocator_traits<alloc>::construct(allocator, new_buff + current_index, *iter);
-                    ++current_index;
-                    ++iter;
-                }
-            }
-            DestructElements();
-            std::allocator_traits<alloc>::deallocate(allocator, buff_, capacity_);
-            buff_ = std::move(new_buff);
-            ++size_;
-            head_ = Iter<T>(buff_, capacity_);
-            tail_ = head_ + size_;
-        }
-        iterator iter = Iter<T>(buff_, &buff_[position], capacity_);
-        return iter;
+        return InsertN(position, 1, [&](size_type) -> const value_type& { return k; });
     }
 
     iterator insert(size_type position, size_type number_of_copies, value_type k) {
-        if (position >= size_) {
-            throw std::invalid_argument("Index out of range");
-        }
-        if (size_ == capacity_ - 1 || number_of_copies + size_ >= capacity_) {
-            size_type new_capacity = capacity_ * kCapacityCoefficient + number_of_copies;
-            pointer new_buff = std::allocator_traits<alloc>::allocate(allocator, new_capacity);
-            size_type current_index = 0;
-            iterator iter = begin();
-            while (iter != end()) {
-                if (current_index == position) {
-                    for (int i = 0; i < number_of_copies; ++i) {
-                        std::allocator_traits<alloc>::construct(allocator, new_buff + current_index, k);
-                        ++current_index;
-                        ++size_;
-                    }
-                } else {
-                    std::allocator_traits<alloc>::construct(allocator, new_buff + current_index, *iter);
-                    ++current_index;
-                    ++iter;
-                }
-            }
-            DestructElements();
-            std::allocator_traits<alloc>::deallocate(allocator, buff_, capacity_);
-            buff_ = std::move(new_buff);
-            head_ = Iter<T>(buff_, capacity_);
-            tail_ = head_ + size_;
-        } else {
-            pointer new_buff = std::allocator_traits<alloc>::allocate(allocator, capacity_);
-            size_type current_index = 0;
-            iterator iter = begin();
-            while (iter != end()) {
-                if (current_index == position) {
-                    for (int i = 0; i < number_of_copies; ++i) {
-                        std::allocator_traits<alloc>::construct(allocator, new_buff + current_index, k);
-                        ++current_index;
-                        ++size_;
-                    }
-                } else {
-                    std::allocator_traits<alloc>::construct(allocator, new_buff + current_index, *iter);
-                    ++current_index;
-                    ++iter;
-                }
-            }
-            DestructElements();
-            std::allocator_traits<alloc>::deallocate(allocator, buff_, capacity_);
-            buff_ = std::move(new_buff);
-
-            head_ = Iter<T>(buff_, capacity_);
-            tail_ = head_ + size_;
-        }
-        iterator iter = Iter<T>(buff_, &buff_[position], capacity_);
-        return iter;
+        return InsertN(position, number_of_copies, [&](size_type) -> const value_type& { return k; });
     }
 
     iterator insert(size_type position, const std::initializer_list<T>& il) {
-        if (position >= size_) {
-            throw std::invalid_argument("Index out of range");
-        }
-        if (size_ == capacity_ - 1 || il.size() + size_ >= capacity_) {
-            size_type new_capacity = capacity_ * kCapacityCoefficient + il.size();
-            pointer new_buff = std::allocator_traits<alloc>::allocate(allocator, new_capacity);
-            size_type current_index = 0;
-            iterator iter = begin();
-            while (iter != end()) {
-                if (current_index == position) {
-                    for (auto it = il.begin(); it != il.end(); ++it) {
-                        std::allocator_traits<alloc>::construct(allocator, new_buff + current_index, *it);
-                        ++current_index;
-                        ++size_;
-                    }
-                } else {
-                    std::allocator_traits<alloc>::construct(allocator, new_buff + current_index, *iter);
-                    ++current_index;
-                    ++iter;
-                }
-            }
-            DestructElements();
-            std::allocator_traits<alloc>::deallocate(allocator, buff_, capacity_);
-            buff_ = std::move(new_buff);
-            head_ = Iter<T>(buff_, capacity_);
-            tail_ = head_ + size_;
-        } else {
-            pointer new_buff = std::allocator_traits<alloc>::allocate(allocator, capacity_);
-            size_type current_index = 0;
-            iterator iter = begin();
-            while (iter != end()) {
-                if (current_index == position) {
-                    for (auto it = il.begin(); it != il.end(); ++it) {
-                        std::allocator_traits<alloc>::construct(allocator, new_buff + current_index, *it);
-                        ++current_index;
-                        ++size_;
-                    }
-                } else {
-                    std::allocator_traits<alloc>::construct(allocator, new_buff + current_index, *iter);
-                    ++current_index;
-                    ++iter;
-                }
-            }
-            DestructElements();
-            std::allocator_traits<alloc>::deallocate(allocator, buff_, capacity_);
-            buff_ = std::move(new_buff);
-            head_ = Iter<T>(buff_, capacity_);
-            tail_ = head_ + size_;
-        }
-        iterator iter = Iter<T>(buff_, &buff_[position], capacity_);
-        return iter;
+        return InsertN(position, il.size(), [&](size_type i) -> const value_type& { return il.begin()[i]; });
     }
 
-    constexpr void swap(ExtBuffer& other) {
-        std::swap(capacity_, other.capacity_);
-        std::swap(size_, other.size_);
-        std::swap(head_, other.head_);
-        std::swap(tail_, other.tail_);
-        std::swap(buff_, other.buff_);
+    // [first, last) must not point into this buffer: growing or shifting the elements invalidates it, as
+    // for std::vector::insert.
+    template<std::forward_iterator U>
+    iterator insert(size_type position, U first, U last) {
+        return InsertN(position, static_cast<size_type>(std::distance(first, last)), [&](size_type) -> decltype(auto) {
+            return *first++;
+        });
+    }
+
+    // Allocators that do not propagate on swap must compare equal, as for the standard containers.
+    constexpr void swap(ExtBuffer& other) noexcept {
+        if constexpr (kPropagateOnSwap) {
+            std::swap(allocator, other.allocator);
+        }
+        SwapStorage(other);
     }
 
-    constexpr static void swap(ExtBuffer& first, ExtBuffer& second) {
-        std::swap(first.capacity_, second.capacity_);
-        std::swap(first.size_, second.size_);
-        std::swap(first.head_, second.head_);
-        std::swap(first.tail_, second.tail_);
-        std::swap(first.buff_, second.buff_);
+    constexpr static void swap(ExtBuffer& first, ExtBuffer& second) noexcept {
+        first.swap(second);
     }
 
     constexpr size_type size() {
@@ -842,8 +1648,9 @@ public:
     }
 
     void clear() {
+        DestructElements();
         head_ = Iter<value_type>(buff_, capacity_);
-        tail_ = ++Iter<value_type>(buff_, capacity_);
+        tail_ = Iter<value_type>(buff_, capacity_);
         size_ = 0;
     }
 
@@ -851,6 +1658,23 @@ public:
         return capacity_ - 1;
     }
 
+    // Number of elements that fit before the next reallocation.
+    constexpr size_type capacity() const noexcept {
+        return capacity_ == 0 ? 0 : capacity_ - 1;
+    }
+
+    void reserve(size_type capacity) {
+        if (capacity + 1 > capacity_) {
+            Reallocate(capacity + 1);
+        }
+    }
+
+    void shrink_to_fit() {
+        if (capacity_ > size_ + 1) {
+            Reallocate(size_ + 1);
+        }
+    }
+
     constexpr bool empty() {
         return size_ == 0;
     }
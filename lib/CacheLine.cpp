@@ -0,0 +1 @@
+#include "CacheLine.h"
\ No newline at end of file
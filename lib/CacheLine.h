@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstddef>
+
+// Size that indices written by different threads are aligned to, so that each sits on its own cache
+// line and threads only share a line when one of them has to look at another's progress.
+inline constexpr size_t kCacheLineSize = 64;
@@ -3,9 +3,21 @@
 #include <iostream>
 #include <functional>
 #include <type_traits>
+#include <concepts>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <array>
+#include <algorithm>
+#include <iterator>
+#include <memory>
 
 #include "xrange.h"
 #include "zip.h"
+#include "pipeline.h"
 
 namespace extraAlgorithms {
 
@@ -19,6 +31,18 @@ namespace extraAlgorithms {
         typename std::iterator_traits<T>::iterator_category;
     };
 
+    template<typename R>
+    concept Range = requires(R& range) {
+        std::begin(range);
+        std::end(range);
+    };
+
+    template<Range R>
+    using RangeValue = typename std::iterator_traits<decltype(std::begin(std::declval<R&>()))>::value_type;
+
+    template<typename R>
+    concept CompileTimeRange = is_ct_xrange<std::remove_cvref_t<R>>::value;
+
     template<Iterator iterator, Function<typename std::iterator_traits<iterator>::value_type> Predicate>
     inline bool all_of(iterator first, iterator last, Predicate predicate) noexcept {
         for (iterator i = first; i != last; ++i) {
@@ -59,6 +83,41 @@ namespace extraAlgorithms {
         return flag;
     }
 
+    // Range overloads of the quantifiers. A ct_xrange is folded over its values, so the check is fully unrolled.
+    template<Range R, Function<RangeValue<R>> Predicate>
+    constexpr bool all_of(R&& range, Predicate predicate) noexcept {
+        if constexpr (CompileTimeRange<R>) {
+            return std::remove_cvref_t<R>::apply([&](auto... values) { return (predicate(values) && ...); });
+        } else {
+            return all_of(std::begin(range), std::end(range), predicate);
+        }
+    }
+
+    template<Range R, Function<RangeValue<R>> Predicate>
+    constexpr bool any_of(R&& range, Predicate predicate) noexcept {
+        if constexpr (CompileTimeRange<R>) {
+            return std::remove_cvref_t<R>::apply([&](auto... values) { return (predicate(values) || ...); });
+        } else {
+            return any_of(std::begin(range), std::end(range), predicate);
+        }
+    }
+
+    template<Range R, Function<RangeValue<R>> Predicate>
+    constexpr bool none_of(R&& range, Predicate predicate) noexcept {
+        return !any_of(std::forward<R>(range), predicate);
+    }
+
+    template<Range R, Function<RangeValue<R>> Predicate>
+    constexpr bool one_of(R&& range, Predicate predicate) noexcept {
+        if constexpr (CompileTimeRange<R>) {
+            return std::remove_cvref_t<R>::apply([&](auto... values) {
+                return ((predicate(values) ? 1 : 0) + ... + 0) == 1;
+            });
+        } else {
+            return one_of(std::begin(range), std::end(range), predicate);
+        }
+    }
+
     template<Iterator iterator, Function<typename std::iterator_traits<iterator>::value_type, typename std::iterator_traits<iterator>::value_type> Predicate>
     inline std::enable_if<std::is_same<typename std::iterator_traits<iterator>::iterator_category,
             std::random_access_iterator_tag>::value, bool>::type
@@ -126,4 +185,284 @@ namespace extraAlgorithms {
         return true;
     }
 
+    enum class Schedule {
+        Static,   // one contiguous block per thread, no coordination after the start
+        Dynamic,  // threads take blocks of `grain` elements from a shared counter
+        Guided    // like Dynamic, but blocks start large and shrink towards `grain`
+    };
+
+    // Calls body(value) for every value of the range, spread over `threads` threads (the caller is one of them).
+    // Work is handed out by index, so negative steps and floating-point ranges produce exactly the values
+    // that a sequential loop would. The first exception thrown by body is rethrown after all threads finish.
+    template<typename T, typename Body>
+    requires std::is_arithmetic_v<T> && std::invocable<Body&, T>
+    void parallel_for(const xrange<T>& range, Body body, size_t grain = 1, Schedule schedule = Schedule::Static,
+                      size_t threads = std::thread::hardware_concurrency()) {
+        const size_t size = range.size();
+        grain = grain == 0 ? 1 : grain;
+        threads = threads == 0 ? 1 : threads;
+        if (threads > (size + grain - 1) / grain) {
+            threads = (size + grain - 1) / grain;
+        }
+        if (threads <= 1) {
+            for (auto value : range) {
+                body(value);
+            }
+            return;
+        }
+
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        std::atomic<bool> failed = false;
+        auto run = [&](size_t first, size_t last) {
+            try {
+                for (auto it = range.begin() + static_cast<std::ptrdiff_t>(first),
+                             end = range.begin() + static_cast<std::ptrdiff_t>(last); it != end; ++it) {
+                    body(*it);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+        };
+
+        std::atomic<size_t> next = 0;
+        auto worker = [&](size_t thread_index) {
+            if (schedule == Schedule::Static) {
+                const size_t base = size / threads;
+                const size_t extra = size % threads;
+                const size_t first = thread_index * base + (thread_index < extra ? thread_index : extra);
+                run(first, first + base + (thread_index < extra ? 1 : 0));
+                return;
+            }
+            while (!failed) {
+                size_t first = next.load();
+                size_t count;
+                do {
+                    if (first >= size) {
+                        return;
+                    }
+                    count = grain;
+                    if (schedule == Schedule::Guided && (size - first) / (2 * threads) > grain) {
+                        count = (size - first) / (2 * threads);
+                    }
+                    if (count > size - first) {
+                        count = size - first;
+                    }
+                } while (!next.compare_exchange_weak(first, first + count));
+                run(first, first + count);
+            }
+        };
+
+        // jthread joins on destruction, so threads that already started are waited for even when starting
+        // a later one throws.
+        std::vector<std::jthread> pool;
+        pool.reserve(threads - 1);
+        try {
+            for (size_t i = 1; i < threads; ++i) {
+                pool.emplace_back(worker, i);
+            }
+        } catch (...) {
+            failed = true;
+            throw;
+        }
+        worker(0);
+        pool.clear();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    enum class Reduction {
+        Deterministic,  // fixed blocks merged in order: the same result as the sequential call, for any thread count
+        Fast            // one block per thread: fewer merges, but the result may change with the number of threads
+    };
+
+    // Passed first to the zip kernels to run them on `threads` threads (the caller is one of them).
+    struct Parallel {
+        size_t threads = std::thread::hardware_concurrency();
+        Reduction reduction = Reduction::Deterministic;
+    };
+
+    template<Range R>
+    using RangeReference = decltype(*std::begin(std::declval<R&>()));
+
+    template<typename... Ranges>
+    concept IndexableRanges = (std::random_access_iterator<decltype(std::begin(std::declval<Ranges&>()))> && ...);
+
+    // Rows handled by one task of the parallel kernels, and the number of accumulators of the reduction kernel.
+    inline constexpr size_t kKernelBlock = 1 << 14;
+    inline constexpr size_t kReduceLanes = 16;
+
+    // Contiguous ranges are read through raw pointers, which keeps iterator wrappers out of the kernel loops
+    // and lets the compiler vectorize them.
+    template<typename It>
+    constexpr auto KernelBase(It iterator) {
+        if constexpr (std::contiguous_iterator<It>) {
+            return std::to_address(iterator);
+        } else {
+            return iterator;
+        }
+    }
+
+    template<typename... Ranges>
+    constexpr auto KernelBases(Ranges&... ranges) {
+        return std::tuple(KernelBase(std::begin(ranges))...);
+    }
+
+    template<typename... Ranges>
+    constexpr size_t KernelSize(Ranges&... ranges) {
+        return std::min({static_cast<size_t>(std::end(ranges) - std::begin(ranges))...});
+    }
+
+    // Reduces rows [first, last) with kReduceLanes independent accumulators that are merged pairwise at the
+    // end. The accumulators break the dependency chain of a single running sum and the unrolled lane loop
+    // turns into a few independent vector operations per step; the merge order is fixed, so the result is
+    // the same on every run.
+    template<typename T, typename Reduce, typename Transform, typename Bases>
+    T LaneReduce(Reduce& reduce, Transform& transform, const Bases& bases, size_t first, size_t last) {
+        auto row = [&](size_t i) -> T {
+            return std::apply([&](const auto&... base) { return static_cast<T>(transform(base[i]...)); }, bases);
+        };
+        if constexpr (std::default_initializable<T>) {
+            if (last - first >= 2 * kReduceLanes) {
+                std::array<T, kReduceLanes> lanes;
+                for (size_t lane = 0; lane < kReduceLanes; ++lane) {
+                    lanes[lane] = row(first + lane);
+                }
+                size_t i = first + kReduceLanes;
+                for (; i + kReduceLanes <= last; i += kReduceLanes) {
+#pragma GCC unroll 16
+                    for (size_t lane = 0; lane < kReduceLanes; ++lane) {
+                        lanes[lane] = reduce(lanes[lane], row(i + lane));
+                    }
+                }
+                for (; i < last; ++i) {
+                    lanes[0] = reduce(lanes[0], row(i));
+                }
+                for (size_t width = kReduceLanes / 2; width > 0; width /= 2) {
+                    for (size_t lane = 0; lane < width; ++lane) {
+                        lanes[lane] = reduce(lanes[lane], lanes[lane + width]);
+                    }
+                }
+                return lanes[0];
+            }
+        }
+        T result = row(first);
+        for (size_t i = first + 1; i < last; ++i) {
+            result = reduce(result, row(i));
+        }
+        return result;
+    }
+
+    // zip_reduce(init, combine, a, b, ...) folds the rows of zip(a, b, ...) in order:
+    // init = combine(init, a[i], b[i], ...). Random-access ranges are walked by a single index.
+    template<typename T, typename Combine, Range... Ranges>
+    requires (sizeof...(Ranges) > 0) && std::invocable<Combine&, T, RangeReference<Ranges>...>
+    T zip_reduce(T init, Combine combine, Ranges&&... ranges) {
+        if constexpr (IndexableRanges<Ranges...>) {
+            const size_t size = KernelSize(ranges...);
+            const auto bases = KernelBases(ranges...);
+            for (size_t i = 0; i < size; ++i) {
+                init = std::apply([&](const auto&... base) { return combine(std::move(init), base[i]...); }, bases);
+            }
+        } else {
+            for (auto row : zip(std::forward<Ranges>(ranges)...)) {
+                init = std::apply([&](auto&&... values) { return combine(std::move(init), values...); }, row);
+            }
+        }
+        return init;
+    }
+
+    // zip_reduce(init, reduce, transform, a, b, ...) is a transform-reduce over the rows of zip(a, b, ...):
+    // transform(a[i], b[i], ...) is applied to every row and the results are merged with reduce, which must
+    // be associative. Random-access inputs go through LaneReduce block by block, so e.g. a dot product
+    //     zip_reduce(0.0, std::plus<>{}, std::multiplies<>{}, a, b)
+    // runs at vector width. Blocks are merged in order, which the parallel overload repeats exactly.
+    template<typename T, typename Reduce, typename Transform, Range... Ranges>
+    requires (sizeof...(Ranges) > 0) && std::invocable<Reduce&, T, T> &&
+             std::invocable<Transform&, RangeReference<Ranges>...>
+    T zip_reduce(T init, Reduce reduce, Transform transform, Ranges&&... ranges) {
+        if constexpr (IndexableRanges<Ranges...>) {
+            const size_t size = KernelSize(ranges...);
+            const auto bases = KernelBases(ranges...);
+            for (size_t first = 0; first < size; first += kKernelBlock) {
+                init = reduce(init, LaneReduce<T>(reduce, transform, bases, first, std::min(size, first + kKernelBlock)));
+            }
+        } else {
+            for (auto row : zip(std::forward<Ranges>(ranges)...)) {
+                init = reduce(init, std::apply([&](auto&&... values) { return static_cast<T>(transform(values...)); }, row));
+            }
+        }
+        return init;
+    }
+
+    // Parallel transform-reduce. With Reduction::Deterministic the rows are reduced in the same fixed blocks
+    // as the sequential overload and the block results are merged in order, so the result does not depend
+    // on the thread count or on scheduling. Reduction::Fast gives every thread one large block instead.
+    template<typename T, typename Reduce, typename Transform, Range... Ranges>
+    requires (sizeof...(Ranges) > 0) && IndexableRanges<Ranges...> && std::invocable<Reduce&, T, T> &&
+             std::invocable<Transform&, RangeReference<Ranges>...>
+    T zip_reduce(const Parallel& policy, T init, Reduce reduce, Transform transform, Ranges&&... ranges) {
+        const size_t size = KernelSize(ranges...);
+        if (size == 0) {
+            return init;
+        }
+        const auto bases = KernelBases(ranges...);
+        const size_t threads = policy.threads == 0 ? 1 : policy.threads;
+        const size_t block = policy.reduction == Reduction::Fast ? (size + threads - 1) / threads : kKernelBlock;
+        const size_t blocks = (size + block - 1) / block;
+
+        std::vector<std::optional<T>> partial(blocks);
+        parallel_for(xrange<size_t>(blocks), [&](size_t index) {
+            const size_t first = index * block;
+            partial[index].emplace(LaneReduce<T>(reduce, transform, bases, first, std::min(size, first + block)));
+        }, 1, Schedule::Dynamic, threads);
+        for (auto& value : partial) {
+            init = reduce(init, std::move(*value));
+        }
+        return init;
+    }
+
+    // zip_transform(out, f, a, b, ...) writes f(a[i], b[i], ...) for every row of zip(a, b, ...) to out and
+    // returns the end of the written output. Random-access inputs and output make it a single indexed loop.
+    template<typename Out, typename F, Range... Ranges>
+    requires (sizeof...(Ranges) > 0) && std::invocable<F&, RangeReference<Ranges>...>
+    Out zip_transform(Out out, F f, Ranges&&... ranges) {
+        if constexpr (IndexableRanges<Ranges...> && std::random_access_iterator<Out>) {
+            const size_t size = KernelSize(ranges...);
+            const auto bases = KernelBases(ranges...);
+            const auto target = KernelBase(out);
+            for (size_t i = 0; i < size; ++i) {
+                target[i] = std::apply([&](const auto&... base) { return f(base[i]...); }, bases);
+            }
+            return out + static_cast<std::ptrdiff_t>(size);
+        } else {
+            for (auto row : zip(std::forward<Ranges>(ranges)...)) {
+                *out = std::apply([&](auto&&... values) { return f(values...); }, row);
+                ++out;
+            }
+            return out;
+        }
+    }
+
+    // Parallel zip_transform: every thread writes its own blocks of the output.
+    template<std::random_access_iterator Out, typename F, Range... Ranges>
+    requires (sizeof...(Ranges) > 0) && IndexableRanges<Ranges...> && std::invocable<F&, RangeReference<Ranges>...>
+    Out zip_transform(const Parallel& policy, Out out, F f, Ranges&&... ranges) {
+        const size_t size = KernelSize(ranges...);
+        const auto bases = KernelBases(ranges...);
+        const auto target = KernelBase(out);
+        parallel_for(xrange<size_t>((size + kKernelBlock - 1) / kKernelBlock), [&](size_t index) {
+            const size_t last = std::min(size, (index + 1) * kKernelBlock);
+            for (size_t i = index * kKernelBlock; i < last; ++i) {
+                target[i] = std::apply([&](const auto&... base) { return f(base[i]...); }, bases);
+            }
+        }, 1, Schedule::Dynamic, policy.threads);
+        return out + static_cast<std::ptrdiff_t>(size);
+    }
+
 }
@@ -0,0 +1 @@
+#include "MirroredBuffer.h"
\ No newline at end of file
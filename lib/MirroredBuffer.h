@@ -0,0 +1,237 @@
+#pragma once
+
+#include "Buffer.h"
+
+#if defined(__linux__)
+
+#include <numeric>
+#include <unistd.h>
+
+// Circular buffer whose storage is mapped twice, back to back: the same memfd pages appear at
+// [base, base + bytes) and again at [base + bytes, base + 2 * bytes). Whatever the head, the elements
+// [head, head + size) are one contiguous address range, so views are a single span, iterators are raw
+// pointers and parsers, memcmp or write(2) can work on the data in place. Like Buffer, push_back drops
+// the oldest element once the buffer is full; there is no spare slot.
+//
+// The capacity is rounded up so that the storage is a whole number of pages. Since every element lives
+// at two addresses, only trivially copyable types are allowed. Linux only.
+template<typename T>
+class MirroredBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "mirrored elements must be trivially copyable");
+public:
+    using value_type = T;
+    using pointer = T*;
+    using size_type = size_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = T*;
+    using const_iterator = const T*;
+private:
+    pointer base_ = nullptr;
+    size_type capacity_ = 0;
+    size_type head_ = 0;
+    size_type size_ = 0;
+
+    static size_type Bytes(size_type capacity) {
+        const auto unit = std::lcm(static_cast<size_type>(sysconf(_SC_PAGESIZE)), sizeof(T));
+        return (std::max<size_type>(capacity, 1) * sizeof(T) + unit - 1) / unit * unit;
+    }
+
+    // Reserves twice the storage, then maps one memfd over both halves.
+    static pointer Map(size_type bytes) {
+        const int fd = memfd_create("MirroredBuffer", MFD_CLOEXEC);
+        if (fd == -1) {
+            throw std::bad_alloc();
+        }
+        void* base = MAP_FAILED;
+        if (ftruncate(fd, static_cast<off_t>(bytes)) == 0) {
+            base = mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        }
+        if (base != MAP_FAILED) {
+            auto* bytes_base = static_cast<std::byte*>(base);
+            if (mmap(bytes_base, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+                mmap(bytes_base + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+                munmap(base, 2 * bytes);
+                base = MAP_FAILED;
+            }
+        }
+        close(fd);
+        if (base == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        return static_cast<pointer>(base);
+    }
+
+    size_type Tail() const noexcept {
+        return head_ + size_ < capacity_ ? head_ + size_ : head_ + size_ - capacity_;
+    }
+public:
+    MirroredBuffer() = default;
+
+    explicit MirroredBuffer(const size_type capacity) :
+            base_(Map(Bytes(capacity))),
+            capacity_(Bytes(capacity) / sizeof(T)) {}
+
+    MirroredBuffer(const MirroredBuffer& other) : MirroredBuffer(other.capacity_) {
+        append(other.begin(), other.end());
+    }
+
+    MirroredBuffer(MirroredBuffer&& other) noexcept :
+            base_(std::exchange(other.base_, nullptr)),
+            capacity_(std::exchange(other.capacity_, 0)),
+            head_(std::exchange(other.head_, 0)),
+            size_(std::exchange(other.size_, 0)) {}
+
+    MirroredBuffer& operator=(MirroredBuffer other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~MirroredBuffer() {
+        if (base_ != nullptr) {
+            munmap(base_, 2 * capacity_ * sizeof(T));
+        }
+    }
+
+    void swap(MirroredBuffer& other) noexcept {
+        std::swap(base_, other.base_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(head_, other.head_);
+        std::swap(size_, other.size_);
+    }
+
+    iterator begin() noexcept {
+        return base_ + head_;
+    }
+
+    iterator end() noexcept {
+        return base_ + head_ + size_;
+    }
+
+    const_iterator begin() const noexcept {
+        return base_ + head_;
+    }
+
+    const_iterator end() const noexcept {
+        return base_ + head_ + size_;
+    }
+
+    pointer data() noexcept {
+        return base_ + head_;
+    }
+
+    const T* data() const noexcept {
+        return base_ + head_;
+    }
+
+    // All the elements, oldest first, as one contiguous range.
+    std::span<T> as_span() noexcept {
+        return {data(), size_};
+    }
+
+    std::span<const T> as_span() const noexcept {
+        return {data(), size_};
+    }
+
+    reference operator[](const size_type n) {
+        if (n >= size_) {
+            throw std::invalid_argument("Index is out of range");
+        }
+        return data()[n];
+    }
+
+    const_reference operator[](const size_type n) const {
+        if (n >= size_) {
+            throw std::invalid_argument("Index is out of range");
+        }
+        return data()[n];
+    }
+
+    void push_back(const_reference value) {
+        if (capacity_ == 0) {
+            throw std::invalid_argument("The buffer has no capacity");
+        }
+        // Copy first: `value` may be the oldest element, which the store below overwrites.
+        const value_type copy = value;
+        if (size_ == capacity_) {
+            pop_front();
+        }
+        base_[Tail()] = copy;
+        ++size_;
+    }
+
+    // Appends [first, last), dropping the oldest elements as needed; when the range alone does not fit,
+    // only its last max_size() elements are kept. The range must not overlap the buffer.
+    template<std::forward_iterator U>
+    void append(U first, U last) {
+        auto count = static_cast<size_type>(std::distance(first, last));
+        if (count > capacity_) {
+            std::advance(first, count - capacity_);
+            count = capacity_;
+        }
+        if (size_ + count > capacity_) {
+            pop_front(size_ + count - capacity_);
+        }
+        std::copy_n(first, count, base_ + Tail());
+        size_ += count;
+    }
+
+    void push_back(std::span<const value_type> values) {
+        append(values.begin(), values.end());
+    }
+
+    // The free slots after the last element as one contiguous range, e.g. for read(2) straight into the
+    // buffer; commit(n) then adds the first n of them to the elements.
+    std::span<T> spare() noexcept {
+        return {base_ + Tail(), capacity_ - size_};
+    }
+
+    void commit(const size_type count) {
+        if (count > capacity_ - size_) {
+            throw std::invalid_argument("Committing more than the spare room");
+        }
+        size_ += count;
+    }
+
+    void pop_front() {
+        pop_front(1);
+    }
+
+    void pop_front(const size_type count) {
+        if (count > size_) {
+            throw std::invalid_argument("The buffer holds fewer elements");
+        }
+        head_ += count;
+        if (head_ >= capacity_) {
+            head_ -= capacity_;
+        }
+        size_ -= count;
+    }
+
+    // Copies the oldest elements into `out`, as many as fit, removes them and returns their number.
+    size_type read_into(std::span<value_type> out) {
+        const size_type count = std::min(out.size(), size_);
+        std::copy_n(data(), count, out.data());
+        pop_front(count);
+        return count;
+    }
+
+    void clear() noexcept {
+        head_ = 0;
+        size_ = 0;
+    }
+
+    size_type size() const noexcept {
+        return size_;
+    }
+
+    size_type max_size() const noexcept {
+        return capacity_;
+    }
+
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+};
+
+#endif
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Snapshot files of Buffer and ExtBuffer. A snapshot is a SnapshotHeader, padded to
+// kSnapshotHeaderBytes so that the storage that follows starts on a page boundary, then the storage
+// slots of the ring with every element at its slot; unused slots are left as holes. Because the layout
+// is the one in memory, a snapshot can be mapped and used as the storage directly.
+
+enum class LoadMode {
+    Copy,  // read into new storage, checking the checksum
+    Map,   // map the file copy-on-write as the storage (Linux only); pages are read when first touched
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint64_t element_size;
+    uint64_t slots;
+    uint64_t head;
+    uint64_t size;
+    uint64_t checksum;
+};
+
+inline constexpr char kSnapshotMagic[8] = {'R', 'I', 'N', 'G', 'S', 'N', 'A', 'P'};
+inline constexpr size_t kSnapshotHeaderBytes = 4096;
+
+// 64-bit hash of the element bytes, eight bytes at a time.
+inline uint64_t SnapshotChecksum(std::span<const std::byte> bytes, uint64_t hash = 0xcbf29ce484222325) {
+    constexpr uint64_t kPrime = 0x100000001b3;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= bytes.size(); i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes.data() + i, sizeof(word));
+        hash = (hash ^ word) * kPrime;
+        hash ^= hash >> 29;
+    }
+    for (; i < bytes.size(); ++i) {
+        hash = (hash ^ static_cast<uint64_t>(bytes[i])) * kPrime;
+    }
+    return hash;
+}
+
+struct SnapshotFileCloser {
+    void operator()(std::FILE* file) const noexcept {
+        std::fclose(file);
+    }
+};
+
+using SnapshotFile = std::unique_ptr<std::FILE, SnapshotFileCloser>;
+
+inline SnapshotFile OpenSnapshot(const std::string& path, const char* mode) {
+    SnapshotFile file(std::fopen(path.c_str(), mode));
+    if (file == nullptr) {
+        throw std::runtime_error("Cannot open snapshot " + path);
+    }
+    return file;
+}
+
+inline void SnapshotIo(bool done, const std::string& path) {
+    if (!done) {
+        throw std::runtime_error("Cannot read or write snapshot " + path);
+    }
+}
+
+// Writes a ring of `slots` slots whose elements are `first` (from slot `head` on) followed by `second`
+// (from slot 0 on).
+inline void SaveSnapshot(const std::string& path, size_t element_size, uint64_t slots, uint64_t head,
+                         std::span<const std::byte> first, std::span<const std::byte> second) {
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.element_size = element_size;
+    header.slots = slots;
+    header.head = head;
+    header.size = (first.size() + second.size()) / element_size;
+    header.checksum = SnapshotChecksum(second, SnapshotChecksum(first));
+
+    SnapshotFile file = OpenSnapshot(path, "wb");
+    SnapshotIo(std::fwrite(&header, sizeof(header), 1, file.get()) == 1, path);
+    const auto write_at = [&](uint64_t slot, std::span<const std::byte> bytes) {
+        SnapshotIo(std::fseek(file.get(), static_cast<long>(kSnapshotHeaderBytes + slot * element_size), SEEK_SET) == 0, path);
+        SnapshotIo(std::fwrite(bytes.data(), 1, bytes.size(), file.get()) == bytes.size(), path);
+    };
+    if (!first.empty()) {
+        write_at(head, first);
+    }
+    if (!second.empty()) {
+        write_at(0, second);
+    }
+    // Give the file its full length; unless it was written above, the last byte is in a free slot.
+    const uint64_t written = first.empty() && second.empty()
+                             ? 0
+                             : std::max(head * element_size + first.size(), second.size());
+    if (written < slots * element_size || slots == 0) {
+        SnapshotIo(std::fseek(file.get(), static_cast<long>(kSnapshotHeaderBytes + slots * element_size - 1), SEEK_SET) == 0, path);
+        SnapshotIo(std::fputc(0, file.get()) != EOF, path);
+    }
+    SnapshotIo(std::fflush(file.get()) == 0, path);
+}
+
+inline SnapshotHeader ReadSnapshotHeader(const std::string& path, size_t element_size) {
+    SnapshotFile file = OpenSnapshot(path, "rb");
+    SnapshotHeader header{};
+    SnapshotIo(std::fread(&header, sizeof(header), 1, file.get()) == 1, path);
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0 || header.element_size != element_size ||
+        header.size > header.slots || (header.slots != 0 && header.head >= header.slots)) {
+        throw std::invalid_argument("Not a snapshot of this buffer type: " + path);
+    }
+    SnapshotIo(std::fseek(file.get(), 0, SEEK_END) == 0, path);
+    if (static_cast<uint64_t>(std::ftell(file.get())) < kSnapshotHeaderBytes + header.slots * element_size) {
+        throw std::invalid_argument("Truncated snapshot: " + path);
+    }
+    return header;
+}
+
+// Reads the elements of the snapshot into their slots of `storage` and checks the checksum.
+inline void ReadSnapshotSlots(const std::string& path, const SnapshotHeader& header, std::byte* storage) {
+    SnapshotFile file = OpenSnapshot(path, "rb");
+    const uint64_t first = std::min(header.size, header.slots - header.head);
+    const auto read_at = [&](uint64_t slot, uint64_t count) {
+        const std::span<std::byte> bytes(storage + slot * header.element_size, count * header.element_size);
+        SnapshotIo(std::fseek(file.get(), static_cast<long>(kSnapshotHeaderBytes + slot * header.element_size), SEEK_SET) == 0, path);
+        SnapshotIo(std::fread(bytes.data(), 1, bytes.size(), file.get()) == bytes.size(), path);
+        return std::span<const std::byte>(bytes);
+    };
+    uint64_t checksum = SnapshotChecksum(first == 0 ? std::span<const std::byte>() : read_at(header.head, first));
+    if (header.size != first) {
+        checksum = SnapshotChecksum(read_at(0, header.size - first), checksum);
+    }
+    if (checksum != header.checksum) {
+        throw std::invalid_argument("Snapshot checksum mismatch: " + path);
+    }
+}
+
+// Maps the storage of the snapshot copy-on-write and returns its first slot; `mapped_bytes` receives the
+// length to pass to UnmapSnapshot.
+inline std::byte* MapSnapshot(const std::string& path, const SnapshotHeader& header, size_t& mapped_bytes) {
+#if defined(__linux__)
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error("Cannot open snapshot " + path);
+    }
+    mapped_bytes = kSnapshotHeaderBytes + header.slots * header.element_size;
+    void* memory = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("Cannot map snapshot " + path);
+    }
+    return static_cast<std::byte*>(memory) + kSnapshotHeaderBytes;
+#else
+    throw std::invalid_argument("Mapping snapshots is only supported on Linux");
+#endif
+}
+
+inline void UnmapSnapshot(std::byte* storage, size_t mapped_bytes) noexcept {
+#if defined(__linux__)
+    munmap(storage - kSnapshotHeaderBytes, mapped_bytes);
+#endif
+}
@@ -0,0 +1 @@
+#include "SpscBuffer.h"
\ No newline at end of file
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "Buffer.h"
+#include "CacheLine.h"
+
+// What SpscBuffer does with new elements when it is full: RejectWhenFull refuses them (push_back returns
+// false), OverwriteOldest drops the oldest unread elements to make room, like Buffer::push_back.
+struct RejectWhenFull {};
+struct OverwriteOldest {};
+
+// Lock-free circular buffer for one producer thread and one consumer thread. The capacity is rounded up
+// to a power of two and elements are addressed by 64-bit positions that never wrap, as in MaskedIter.
+//
+// The producer publishes written elements by a release store of tail_, the consumer frees slots by a
+// release store of head_. Each side keeps a private copy of the other one's index and only reloads it
+// when that copy says the buffer is full (or empty), so in the steady state neither side touches the
+// other's cache line. The bulk calls publish a whole batch with one store.
+//
+// With OverwriteOldest the producer may also take unread elements away from the consumer, so both sides
+// claim elements through claim_ with a CAS. The consumer marks head_ as reading before it claims a batch;
+// a producer that needs the slots of that batch waits until the consumer has moved the elements out.
+template<typename T, typename Policy = RejectWhenFull, typename alloc = std::allocator<T>>
+class SpscBuffer {
+    static_assert(std::is_same_v<Policy, RejectWhenFull> || std::is_same_v<Policy, OverwriteOldest>, "unknown full buffer policy");
+
+    static constexpr bool kOverwrite = std::is_same_v<Policy, OverwriteOldest>;
+    // Set in head_ while the consumer is moving a claimed batch out of the ring.
+    static constexpr uint64_t kReading = uint64_t(1) << 63;
+public:
+    using pointer = T*;
+    using size_type = size_t;
+    using value_type = T;
+private:
+    alloc allocator;
+    uint64_t slots_ = 0;
+    uint64_t mask_ = 0;
+    pointer buff_ = nullptr;
+
+    // Producer: next position to write, and the positions below which every slot is known to be free.
+    alignas(kCacheLineSize) std::atomic<uint64_t> tail_{0};
+    uint64_t free_below_ = 0;
+
+    // Consumer: next position to read (plus kReading, see above), and the last tail it has seen.
+    alignas(kCacheLineSize) std::atomic<uint64_t> head_{0};
+    uint64_t seen_tail_ = 0;
+
+    // OverwriteOldest only: the first position that neither side has taken yet.
+    alignas(kCacheLineSize) std::atomic<uint64_t> claim_{0};
+
+    // Makes room for up to `count` elements at the tail and returns how many may be written.
+    size_type Acquire(size_type count) {
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if constexpr (!kOverwrite) {
+            if (tail + count - free_below_ > slots_) {
+                free_below_ = head_.load(std::memory_order_acquire);
+            }
+            return std::min<uint64_t>(count, slots_ - (tail - free_below_));
+        } else {
+            if (tail + count <= slots_) {
+                return count;
+            }
+            const uint64_t first_kept = tail + count - slots_;
+            if (free_below_ >= first_kept) {
+                return count;
+            }
+            uint64_t claimed = claim_.load(std::memory_order_acquire);
+            while (claimed < first_kept &&
+                   !claim_.compare_exchange_weak(claimed, first_kept, std::memory_order_acq_rel, std::memory_order_acquire)) {}
+            if constexpr (!std::is_trivially_destructible_v<value_type>) {
+                for (uint64_t position = claimed; position < first_kept; ++position) {
+                    std::allocator_traits<alloc>::destroy(allocator, buff_ + (position & mask_));
+                }
+            }
+            // Positions from `claimed` on were dropped above; the ones below went to the consumer, which
+            // may still be moving them out.
+            const uint64_t reused = std::min(claimed, first_kept);
+            for (;;) {
+                const uint64_t head = head_.load(std::memory_order_acquire);
+                if ((head & kReading) == 0) {
+                    free_below_ = std::max(claimed, first_kept);
+                    return count;
+                }
+                if ((head & ~kReading) >= reused) {
+                    free_below_ = first_kept;
+                    return count;
+                }
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Claims up to `count` elements at the head for the consumer, returning the first position and the
+    // number claimed.
+    std::pair<uint64_t, size_type> Claim(size_type count) {
+        if constexpr (!kOverwrite) {
+            const uint64_t head = head_.load(std::memory_order_relaxed);
+            if (seen_tail_ - head < count) {
+                seen_tail_ = tail_.load(std::memory_order_acquire);
+            }
+            return {head, std::min<uint64_t>(count, seen_tail_ - head)};
+        } else {
+            uint64_t claimed = claim_.load(std::memory_order_acquire);
+            bool marked = false;
+            for (;;) {
+                if (seen_tail_ < claimed + count) {
+                    seen_tail_ = tail_.load(std::memory_order_acquire);
+                }
+                const size_type available = seen_tail_ > claimed ? std::min<uint64_t>(count, seen_tail_ - claimed) : 0;
+                if (available == 0) {
+                    if (marked) {
+                        head_.store(claimed, std::memory_order_release);
+                    }
+                    return {claimed, 0};
+                }
+                head_.store(claimed | kReading, std::memory_order_release);
+                marked = true;
+                if (claim_.compare_exchange_strong(claimed, claimed + available, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    return {claimed, available};
+                }
+            }
+        }
+    }
+public:
+    explicit SpscBuffer(const size_type capacity) :
+            slots_(std::bit_ceil(std::max<size_type>(capacity, 1))),
+            mask_(slots_ - 1),
+            buff_(std::allocator_traits<alloc>::allocate(allocator, slots_)) {}
+
+    SpscBuffer(const SpscBuffer&) = delete;
+
+    SpscBuffer& operator=(const SpscBuffer&) = delete;
+
+    // Must not race with either side.
+    ~SpscBuffer() {
+        if constexpr (!std::is_trivially_destructible_v<value_type>) {
+            const uint64_t first = kOverwrite ? claim_.load() : head_.load();
+            for (uint64_t position = first; position < tail_.load(); ++position) {
+                std::allocator_traits<alloc>::destroy(allocator, buff_ + (position & mask_));
+            }
+        }
+        std::allocator_traits<alloc>::deallocate(allocator, buff_, slots_);
+    }
+
+    // Producer side.
+
+    template<typename... Args>
+    bool emplace_back(Args&&... args) {
+        if (Acquire(1) == 0) {
+            return false;
+        }
+        const uint64_t tail = tail_.load(std::memory_order_relaxed);
+        std::allocator_traits<alloc>::construct(allocator, buff_ + (tail & mask_), std::forward<Args>(args)...);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push_back(const value_type& value) {
+        return emplace_back(value);
+    }
+
+    bool push_back(value_type&& value) {
+        return emplace_back(std::move(value));
+    }
+
+    // Writes as many elements of [first, last) as the policy admits and publishes them at once; returns
+    // their number. With OverwriteOldest a range longer than the capacity leaves only its tail.
+    template<std::forward_iterator U>
+    size_type append(U first, U last) {
+        auto count = static_cast<size_type>(std::distance(first, last));
+        if constexpr (kOverwrite) {
+            if (count > slots_) {
+                std::advance(first, count - slots_);
+                count = slots_;
+            }
+        }
+        count = Acquire(count);
+        if (count != 0) {
+            const uint64_t tail = tail_.load(std::memory_order_relaxed);
+            RingConstruct(allocator, buff_, slots_, tail & mask_, first, count);
+            tail_.store(tail + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    size_type push_back(std::span<const value_type> values) {
+        return append(values.begin(), values.end());
+    }
+
+    // Consumer side.
+
+    // Moves the oldest elements into `out`, as many as there are and fit, and returns their number.
+    size_type read_into(std::span<value_type> out) {
+        const auto [first, count] = Claim(out.size());
+        if (count != 0) {
+            RingMoveOut(allocator, buff_, slots_, first & mask_, out.data(), count);
+            head_.store(first + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    bool pop_front(value_type& out) {
+        return read_into(std::span<value_type>(&out, 1)) == 1;
+    }
+
+    // Either side; only a snapshot while the other one is running.
+
+    size_type size() const noexcept {
+        const uint64_t first = kOverwrite ? claim_.load(std::memory_order_acquire) : head_.load(std::memory_order_acquire);
+        const uint64_t last = tail_.load(std::memory_order_acquire);
+        return last > first ? static_cast<size_type>(last - first) : 0;
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    size_type capacity() const noexcept {
+        return slots_;
+    }
+};
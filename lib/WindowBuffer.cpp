@@ -0,0 +1 @@
+#include "WindowBuffer.h"
\ No newline at end of file
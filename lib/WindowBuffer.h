@@ -0,0 +1,192 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+
+#include "Buffer.h"
+
+// Sliding window over the last max_size() values: a Buffer, whose push_back drops the oldest value once
+// it is full, plus aggregates that are updated as values enter and leave, so every query is O(1) and a
+// push is amortized O(1).
+//
+// - sum() and mean() keep a running sum; floating point sums are compensated (Neumaier), so that adding
+//   and later subtracting the same values does not accumulate rounding error over a long stream.
+// - min() and max() keep monotonic deques of the values that can still become the extreme of the window.
+// - Every predicate type in Predicates gets a counter of the values that satisfy it, queried with
+//   count_if<I>(), any_of<I>(), all_of<I>(), none_of<I>() and one_of<I>(). The predicates must be
+//   default constructible and give the same answer for a value when it leaves as when it entered, e.g.
+//   WindowBuffer<double, decltype([](double x) { return x > 100; })>.
+template<typename T, typename... Predicates>
+class WindowBuffer {
+    static_assert(std::totally_ordered<T>, "min and max need ordered values");
+    static_assert((std::default_initializable<Predicates> && ...), "predicates are default constructed");
+    static_assert((std::predicate<const Predicates&, const T&> && ...), "predicates must take a value of the window");
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using const_reference = const T&;
+    using const_iterator = typename Buffer<T>::const_iterator;
+    // Integers are summed in 64 bits, floating point values in their own type.
+    using sum_type = std::conditional_t<std::is_floating_point_v<T>, T, std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+private:
+    Buffer<T> window_;
+    // Positions of the oldest value in the window and of the next one to come.
+    uint64_t first_ = 0;
+    uint64_t next_ = 0;
+    sum_type sum_{};
+    sum_type compensation_{};
+    // (position, value) with increasing values for min_, decreasing ones for max_.
+    std::deque<std::pair<uint64_t, T>> min_;
+    std::deque<std::pair<uint64_t, T>> max_;
+    std::array<size_type, sizeof...(Predicates)> counts_{};
+
+    void Add(sum_type value) {
+        if constexpr (std::is_floating_point_v<T>) {
+            const sum_type sum = sum_ + value;
+            if (std::abs(sum_) >= std::abs(value)) {
+                compensation_ += (sum_ - sum) + value;
+            } else {
+                compensation_ += (value - sum) + sum_;
+            }
+            sum_ = sum;
+        } else {
+            sum_ += value;
+        }
+    }
+
+    template<size_t... I>
+    void CountIn(const T& value, std::index_sequence<I...>) {
+        ((counts_[I] += Predicates{}(value) ? 1 : 0), ...);
+    }
+
+    template<size_t... I>
+    void CountOut(const T& value, std::index_sequence<I...>) {
+        ((counts_[I] -= Predicates{}(value) ? 1 : 0), ...);
+    }
+
+    void Enter(const T& value) {
+        if constexpr (std::is_arithmetic_v<T>) {
+            Add(static_cast<sum_type>(value));
+        }
+        while (!min_.empty() && !(min_.back().second < value)) {
+            min_.pop_back();
+        }
+        min_.emplace_back(next_, value);
+        while (!max_.empty() && !(value < max_.back().second)) {
+            max_.pop_back();
+        }
+        max_.emplace_back(next_, value);
+        CountIn(value, std::index_sequence_for<Predicates...>{});
+        ++next_;
+    }
+
+    void Leave(const T& value) {
+        if constexpr (std::is_arithmetic_v<T>) {
+            Add(-static_cast<sum_type>(value));
+        }
+        if (min_.front().first == first_) {
+            min_.pop_front();
+        }
+        if (max_.front().first == first_) {
+            max_.pop_front();
+        }
+        CountOut(value, std::index_sequence_for<Predicates...>{});
+        ++first_;
+    }
+
+    void CheckNotEmpty() const {
+        if (first_ == next_) {
+            throw std::invalid_argument("The window is empty");
+        }
+    }
+public:
+    explicit WindowBuffer(const size_type capacity) : window_(capacity) {
+        if (capacity == 0) {
+            throw std::invalid_argument("A window needs room for at least one value");
+        }
+    }
+
+    void push_back(const_reference value) {
+        if (window_.size() == window_.max_size()) {
+            Leave(window_[0]);
+        }
+        window_.push_back(value);
+        Enter(value);
+    }
+
+    void pop_front() {
+        CheckNotEmpty();
+        Leave(window_[0]);
+        window_.pop_front();
+    }
+
+    const_reference operator[](const size_type n) const {
+        return window_[n];
+    }
+
+    const_iterator begin() const noexcept {
+        return window_.cbegin();
+    }
+
+    const_iterator end() const noexcept {
+        return window_.cend();
+    }
+
+    size_type size() const noexcept {
+        return static_cast<size_type>(next_ - first_);
+    }
+
+    size_type max_size() {
+        return window_.max_size();
+    }
+
+    bool empty() const noexcept {
+        return first_ == next_;
+    }
+
+    sum_type sum() const requires std::is_arithmetic_v<T> {
+        return sum_ + compensation_;
+    }
+
+    double mean() const requires std::is_arithmetic_v<T> {
+        CheckNotEmpty();
+        return static_cast<double>(sum()) / static_cast<double>(size());
+    }
+
+    const_reference min() const {
+        CheckNotEmpty();
+        return min_.front().second;
+    }
+
+    const_reference max() const {
+        CheckNotEmpty();
+        return max_.front().second;
+    }
+
+    template<size_t I>
+    size_type count_if() const noexcept {
+        return std::get<I>(counts_);
+    }
+
+    template<size_t I>
+    bool any_of() const noexcept {
+        return count_if<I>() != 0;
+    }
+
+    template<size_t I>
+    bool all_of() const noexcept {
+        return count_if<I>() == size();
+    }
+
+    template<size_t I>
+    bool none_of() const noexcept {
+        return count_if<I>() == 0;
+    }
+
+    template<size_t I>
+    bool one_of() const noexcept {
+        return count_if<I>() == 1;
+    }
+};
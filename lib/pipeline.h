@@ -0,0 +1,590 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <concepts>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace extraAlgorithms {
+
+    // Lazy adaptors for xrange, zip and containers:
+    //     xrange(0, 100) | filter(p) | transform(f) | take(n) | stride(k) | enumerate
+    // Every stage is a small view over the previous one and iterators nest, so the whole chain compiles
+    // into a single loop with no intermediate storage. Random access and size() are kept whenever the
+    // stage allows it (everything except filter).
+
+    template<typename V>
+    using ViewIterator = decltype(std::begin(std::declval<const V&>()));
+
+    template<typename It>
+    concept RandomAccessIterator = std::derived_from<typename std::iterator_traits<It>::iterator_category,
+                                                     std::random_access_iterator_tag>;
+
+    template<typename It>
+    using AdaptedCategory = std::conditional_t<RandomAccessIterator<It>, std::random_access_iterator_tag,
+            std::conditional_t<std::derived_from<typename std::iterator_traits<It>::iterator_category,
+                                                 std::forward_iterator_tag>,
+                               std::forward_iterator_tag, std::input_iterator_tag>>;
+
+    template<typename V>
+    concept SizedView = RandomAccessIterator<ViewIterator<V>> || requires(const V& view) {
+        view.size();
+    };
+
+    template<SizedView V>
+    constexpr size_t ViewSize(const V& view) {
+        if constexpr (requires { view.size(); }) {
+            return static_cast<size_t>(view.size());
+        } else {
+            return static_cast<size_t>(std::end(view) - std::begin(view));
+        }
+    }
+
+    // Derived operators shared by the adaptor iterators. A derived iterator defines *, ++ and ==,
+    // plus --, += and iterator difference when it is random-access.
+    template<typename Derived>
+    class PipeIteratorOps {
+    public:
+        using difference_type = std::ptrdiff_t;
+
+        friend Derived operator++(Derived& it, int) {
+            Derived tmp = it;
+            ++it;
+            return tmp;
+        }
+
+        friend Derived operator--(Derived& it, int) {
+            Derived tmp = it;
+            --it;
+            return tmp;
+        }
+
+        friend Derived& operator-=(Derived& it, difference_type n) {
+            return it += -n;
+        }
+
+        friend Derived operator+(Derived it, difference_type n) {
+            return it += n;
+        }
+
+        friend Derived operator+(difference_type n, Derived it) {
+            return it += n;
+        }
+
+        friend Derived operator-(Derived it, difference_type n) {
+            return it += -n;
+        }
+
+        friend std::strong_ordering operator<=>(const Derived& first, const Derived& second) {
+            return (first - second) <=> 0;
+        }
+
+        decltype(auto) operator[](difference_type n) const {
+            return *(static_cast<const Derived&>(*this) + n);
+        }
+    };
+
+    // Lvalue containers are viewed through a pointer; rvalues (xrange, zip, other views) are kept by value.
+    template<typename R>
+    class RefView {
+    private:
+        R* range_;
+    public:
+        explicit RefView(R& range) : range_(&range) {}
+
+        auto begin() const {
+            return std::begin(*range_);
+        }
+
+        auto end() const {
+            return std::end(*range_);
+        }
+
+        auto size() const requires requires(R& range) { range.size(); } {
+            return range_->size();
+        }
+    };
+
+    template<typename R>
+    using ViewOf = std::conditional_t<std::is_lvalue_reference_v<R>, RefView<std::remove_reference_t<R>>,
+                                      std::remove_cvref_t<R>>;
+
+    template<typename V, typename Predicate>
+    class FilterView {
+    private:
+        using Base = ViewIterator<V>;
+
+        class FilterIterator {
+        public:
+            using value_type = typename std::iterator_traits<Base>::value_type;
+            using reference = typename std::iterator_traits<Base>::reference;
+            using pointer = void;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = std::conditional_t<std::is_same_v<AdaptedCategory<Base>, std::input_iterator_tag>,
+                                                         std::input_iterator_tag, std::forward_iterator_tag>;
+        private:
+            Base current_{};
+            Base end_{};
+            const FilterView* parent_ = nullptr;
+
+            void Satisfy() {
+                while (current_ != end_ && !std::invoke(parent_->predicate_, *current_)) {
+                    ++current_;
+                }
+            }
+
+        public:
+            FilterIterator() = default;
+
+            FilterIterator(Base current, Base end, const FilterView* parent) : current_(current), end_(end),
+                                                                               parent_(parent) {
+                Satisfy();
+            }
+
+            reference operator*() const {
+                return *current_;
+            }
+
+            FilterIterator& operator++() {
+                ++current_;
+                Satisfy();
+                return *this;
+            }
+
+            FilterIterator operator++(int) {
+                FilterIterator tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            bool operator==(const FilterIterator& other) const {
+                return current_ == other.current_;
+            }
+        };
+
+        V base_;
+        Predicate predicate_;
+    public:
+        using iterator = FilterIterator;
+
+        FilterView(V base, Predicate predicate) : base_(std::move(base)), predicate_(std::move(predicate)) {}
+
+        iterator begin() const {
+            return iterator(std::begin(base_), std::end(base_), this);
+        }
+
+        iterator end() const {
+            return iterator(std::end(base_), std::end(base_), this);
+        }
+    };
+
+    template<typename V, typename Function>
+    class TransformView {
+    private:
+        using Base = ViewIterator<V>;
+
+        class TransformIterator : public PipeIteratorOps<TransformIterator> {
+        public:
+            using reference = std::invoke_result_t<const Function&, typename std::iterator_traits<Base>::reference>;
+            using value_type = std::remove_cvref_t<reference>;
+            using pointer = void;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = AdaptedCategory<Base>;
+        private:
+            Base current_{};
+            const TransformView* parent_ = nullptr;
+        public:
+            TransformIterator() = default;
+
+            TransformIterator(Base current, const TransformView* parent) : current_(current), parent_(parent) {}
+
+            reference operator*() const {
+                return std::invoke(parent_->function_, *current_);
+            }
+
+            TransformIterator& operator++() {
+                ++current_;
+                return *this;
+            }
+
+            TransformIterator& operator--() {
+                --current_;
+                return *this;
+            }
+
+            TransformIterator& operator+=(difference_type n) {
+                current_ += n;
+                return *this;
+            }
+
+            difference_type operator-(const TransformIterator& other) const {
+                return static_cast<difference_type>(current_ - other.current_);
+            }
+
+            bool operator==(const TransformIterator& other) const {
+                return current_ == other.current_;
+            }
+        };
+
+        V base_;
+        Function function_;
+    public:
+        using iterator = TransformIterator;
+
+        TransformView(V base, Function function) : base_(std::move(base)), function_(std::move(function)) {}
+
+        iterator begin() const {
+            return iterator(std::begin(base_), this);
+        }
+
+        iterator end() const {
+            return iterator(std::end(base_), this);
+        }
+
+        size_t size() const requires SizedView<V> {
+            return ViewSize(base_);
+        }
+    };
+
+    template<typename V>
+    class TakeView {
+    private:
+        using Base = ViewIterator<V>;
+        static constexpr bool kRandomAccess = RandomAccessIterator<Base>;
+
+        class TakeIterator : public PipeIteratorOps<TakeIterator> {
+        public:
+            using value_type = typename std::iterator_traits<Base>::value_type;
+            using reference = typename std::iterator_traits<Base>::reference;
+            using pointer = void;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = AdaptedCategory<Base>;
+        private:
+            Base current_{};
+            difference_type index_ = 0;
+        public:
+            TakeIterator() = default;
+
+            TakeIterator(Base current, difference_type index) : current_(current), index_(index) {}
+
+            reference operator*() const {
+                return *current_;
+            }
+
+            TakeIterator& operator++() {
+                ++current_;
+                ++index_;
+                return *this;
+            }
+
+            TakeIterator& operator--() {
+                --current_;
+                --index_;
+                return *this;
+            }
+
+            TakeIterator& operator+=(difference_type n) {
+                current_ += n;
+                index_ += n;
+                return *this;
+            }
+
+            difference_type operator-(const TakeIterator& other) const {
+                return index_ - other.index_;
+            }
+
+            // Without random access the end position of the base is unknown, so the iterator also stops
+            // when the base runs out before n elements.
+            bool operator==(const TakeIterator& other) const {
+                if constexpr (kRandomAccess) {
+                    return index_ == other.index_;
+                } else {
+                    return index_ == other.index_ || current_ == other.current_;
+                }
+            }
+        };
+
+        V base_;
+        size_t count_;
+
+        size_t Count() const requires kRandomAccess {
+            const auto available = static_cast<size_t>(std::end(base_) - std::begin(base_));
+            return std::min(count_, available);
+        }
+
+    public:
+        using iterator = TakeIterator;
+
+        TakeView(V base, size_t count) : base_(std::move(base)), count_(count) {}
+
+        iterator begin() const {
+            return iterator(std::begin(base_), 0);
+        }
+
+        iterator end() const {
+            if constexpr (kRandomAccess) {
+                const auto count = static_cast<std::ptrdiff_t>(Count());
+                return iterator(std::begin(base_) + count, count);
+            } else {
+                return iterator(std::end(base_), static_cast<std::ptrdiff_t>(count_));
+            }
+        }
+
+        size_t size() const requires kRandomAccess {
+            return Count();
+        }
+    };
+
+    template<typename V>
+    class StrideView {
+    private:
+        using Base = ViewIterator<V>;
+        static constexpr bool kRandomAccess = RandomAccessIterator<Base>;
+
+        // A random-access iterator keeps the first element and an index, so any position is one jump away.
+        // Otherwise it walks the base and stops at its end.
+        class StrideIterator : public PipeIteratorOps<StrideIterator> {
+        public:
+            using value_type = typename std::iterator_traits<Base>::value_type;
+            using reference = typename std::iterator_traits<Base>::reference;
+            using pointer = void;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = AdaptedCategory<Base>;
+        private:
+            Base current_{};
+            Base end_{};
+            difference_type stride_ = 1;
+            difference_type index_ = 0;
+        public:
+            StrideIterator() = default;
+
+            StrideIterator(Base current, Base end, difference_type stride, difference_type index) :
+                    current_(current), end_(end), stride_(stride), index_(index) {}
+
+            reference operator*() const {
+                if constexpr (kRandomAccess) {
+                    return current_[index_ * stride_];
+                } else {
+                    return *current_;
+                }
+            }
+
+            StrideIterator& operator++() {
+                if constexpr (!kRandomAccess) {
+                    for (difference_type i = 0; i < stride_ && current_ != end_; ++i) {
+                        ++current_;
+                    }
+                }
+                ++index_;
+                return *this;
+            }
+
+            StrideIterator& operator--() {
+                --index_;
+                return *this;
+            }
+
+            StrideIterator& operator+=(difference_type n) {
+                index_ += n;
+                return *this;
+            }
+
+            difference_type operator-(const StrideIterator& other) const {
+                return index_ - other.index_;
+            }
+
+            bool operator==(const StrideIterator& other) const {
+                if constexpr (kRandomAccess) {
+                    return index_ == other.index_;
+                } else {
+                    return current_ == other.current_;
+                }
+            }
+        };
+
+        V base_;
+        std::ptrdiff_t stride_;
+
+        size_t Count() const requires kRandomAccess {
+            const auto available = static_cast<size_t>(std::end(base_) - std::begin(base_));
+            return (available + static_cast<size_t>(stride_) - 1) / static_cast<size_t>(stride_);
+        }
+
+    public:
+        using iterator = StrideIterator;
+
+        StrideView(V base, size_t stride) : base_(std::move(base)), stride_(static_cast<std::ptrdiff_t>(stride)) {
+            if (stride == 0) {
+                throw std::invalid_argument("stride must be positive");
+            }
+        }
+
+        iterator begin() const {
+            return iterator(std::begin(base_), std::end(base_), stride_, 0);
+        }
+
+        iterator end() const {
+            if constexpr (kRandomAccess) {
+                return iterator(std::begin(base_), std::end(base_), stride_, static_cast<std::ptrdiff_t>(Count()));
+            } else {
+                return iterator(std::end(base_), std::end(base_), stride_, 0);
+            }
+        }
+
+        size_t size() const requires kRandomAccess {
+            return Count();
+        }
+    };
+
+    template<typename V>
+    class EnumerateView {
+    private:
+        using Base = ViewIterator<V>;
+
+        class EnumerateIterator : public PipeIteratorOps<EnumerateIterator> {
+        public:
+            using reference = std::pair<size_t, typename std::iterator_traits<Base>::reference>;
+            using value_type = std::pair<size_t, typename std::iterator_traits<Base>::value_type>;
+            using pointer = void;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = AdaptedCategory<Base>;
+        private:
+            Base current_{};
+            size_t index_ = 0;
+        public:
+            EnumerateIterator() = default;
+
+            EnumerateIterator(Base current, size_t index) : current_(current), index_(index) {}
+
+            reference operator*() const {
+                return reference(index_, *current_);
+            }
+
+            EnumerateIterator& operator++() {
+                ++current_;
+                ++index_;
+                return *this;
+            }
+
+            EnumerateIterator& operator--() {
+                --current_;
+                --index_;
+                return *this;
+            }
+
+            EnumerateIterator& operator+=(difference_type n) {
+                current_ += n;
+                index_ = static_cast<size_t>(static_cast<difference_type>(index_) + n);
+                return *this;
+            }
+
+            difference_type operator-(const EnumerateIterator& other) const {
+                return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+            }
+
+            bool operator==(const EnumerateIterator& other) const {
+                return current_ == other.current_;
+            }
+        };
+
+        V base_;
+    public:
+        using iterator = EnumerateIterator;
+
+        explicit EnumerateView(V base) : base_(std::move(base)) {}
+
+        iterator begin() const {
+            return iterator(std::begin(base_), 0);
+        }
+
+        iterator end() const {
+            if constexpr (SizedView<V>) {
+                return iterator(std::end(base_), ViewSize(base_));
+            } else {
+                return iterator(std::end(base_), 0);
+            }
+        }
+
+        size_t size() const requires SizedView<V> {
+            return ViewSize(base_);
+        }
+    };
+
+    struct PipeAdaptorTag {};
+
+    template<typename R, typename Adaptor>
+    requires std::derived_from<std::remove_cvref_t<Adaptor>, PipeAdaptorTag>
+    auto operator|(R&& range, const Adaptor& adaptor) {
+        return adaptor(std::forward<R>(range));
+    }
+
+    template<typename Predicate>
+    struct FilterAdaptor : PipeAdaptorTag {
+        Predicate predicate;
+
+        template<typename R>
+        auto operator()(R&& range) const {
+            return FilterView<ViewOf<R>, Predicate>(ViewOf<R>(std::forward<R>(range)), predicate);
+        }
+    };
+
+    template<typename Function>
+    struct TransformAdaptor : PipeAdaptorTag {
+        Function function;
+
+        template<typename R>
+        auto operator()(R&& range) const {
+            return TransformView<ViewOf<R>, Function>(ViewOf<R>(std::forward<R>(range)), function);
+        }
+    };
+
+    struct TakeAdaptor : PipeAdaptorTag {
+        size_t count;
+
+        template<typename R>
+        auto operator()(R&& range) const {
+            return TakeView<ViewOf<R>>(ViewOf<R>(std::forward<R>(range)), count);
+        }
+    };
+
+    struct StrideAdaptor : PipeAdaptorTag {
+        size_t stride;
+
+        template<typename R>
+        auto operator()(R&& range) const {
+            return StrideView<ViewOf<R>>(ViewOf<R>(std::forward<R>(range)), stride);
+        }
+    };
+
+    struct EnumerateAdaptor : PipeAdaptorTag {
+        template<typename R>
+        auto operator()(R&& range) const {
+            return EnumerateView<ViewOf<R>>(ViewOf<R>(std::forward<R>(range)));
+        }
+    };
+
+    template<typename Predicate>
+    FilterAdaptor<Predicate> filter(Predicate predicate) {
+        return {{}, std::move(predicate)};
+    }
+
+    template<typename Function>
+    TransformAdaptor<Function> transform(Function function) {
+        return {{}, std::move(function)};
+    }
+
+    inline TakeAdaptor take(size_t count) {
+        return {{}, count};
+    }
+
+    inline StrideAdaptor stride(size_t step) {
+        return {{}, step};
+    }
+
+    inline constexpr EnumerateAdaptor enumerate{};
+
+}
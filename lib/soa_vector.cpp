@@ -0,0 +1 @@
+#include "soa_vector.h"
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "zip.h"
+
+namespace extraAlgorithms {
+
+    // Every column starts on its own cache line, which is also enough for the widest SIMD loads.
+    inline constexpr size_t kColumnAlignment = 64;
+
+    // soa_vector<Ts...> keeps one contiguous, aligned column per field instead of an array of records, so
+    // loops that touch one field read only that field. All columns live in a single allocation that grows
+    // as a whole. Rows are seen through zip: iterating, indexing or sorting yields ZipReference rows, while
+    // column<I>() hands out a plain std::span for kernels that work on one field.
+    template<typename... Ts>
+    class soa_vector {
+        static_assert(sizeof...(Ts) > 0, "soa_vector needs at least one column");
+        static_assert(kColumnAlignment % std::max({alignof(Ts)...}) == 0, "column type is over-aligned");
+    public:
+        using size_type = size_t;
+        using value_type = ZipTuple<Ts...>;
+        using rows_type = zip<std::span<Ts>...>;
+        using const_rows_type = zip<std::span<const Ts>...>;
+        using iterator = typename rows_type::iterator;
+        using const_iterator = typename const_rows_type::iterator;
+        using reference = typename iterator::reference;
+        using const_reference = typename const_iterator::reference;
+
+        template<size_t I>
+        using column_type = std::tuple_element_t<I, std::tuple<Ts...>>;
+    private:
+        using Columns = std::index_sequence_for<Ts...>;
+
+        std::byte* data_ = nullptr;
+        std::tuple<Ts*...> columns_{};
+        size_type size_ = 0;
+        size_type capacity_ = 0;
+
+        // Byte offset of every column (and of the end of the block) for the given capacity.
+        static constexpr std::array<size_type, sizeof...(Ts) + 1> Layout(size_type capacity) {
+            constexpr std::array<size_type, sizeof...(Ts)> sizes = {sizeof(Ts)...};
+            std::array<size_type, sizeof...(Ts) + 1> offsets{};
+            for (size_t i = 0; i < sizes.size(); ++i) {
+                const size_type end = offsets[i] + sizes[i] * capacity;
+                offsets[i + 1] = (end + kColumnAlignment - 1) / kColumnAlignment * kColumnAlignment;
+            }
+            return offsets;
+        }
+
+        static std::byte* Allocate(size_type capacity) {
+            return static_cast<std::byte*>(::operator new(Layout(capacity).back(), std::align_val_t{kColumnAlignment}));
+        }
+
+        static void Deallocate(std::byte* data) {
+            ::operator delete(data, std::align_val_t{kColumnAlignment});
+        }
+
+        static std::tuple<Ts*...> ColumnsOf(std::byte* data, size_type capacity) {
+            const auto offsets = Layout(capacity);
+            return [&]<size_t... I>(std::index_sequence<I...>) {
+                return std::tuple<Ts*...>(reinterpret_cast<Ts*>(data + offsets[I])...);
+            }(Columns{});
+        }
+
+        template<size_t... I>
+        void DestroyRows(size_type first, size_type last, std::index_sequence<I...>) {
+            (std::destroy(std::get<I>(columns_) + first, std::get<I>(columns_) + last), ...);
+        }
+
+        // Moves the rows into a block of the new capacity; on failure the old block stays untouched.
+        void Reallocate(size_type capacity) {
+            std::byte* data = Allocate(capacity);
+            std::tuple<Ts*...> columns = ColumnsOf(data, capacity);
+            size_t relocated = 0;
+            try {
+                [&]<size_t... I>(std::index_sequence<I...>) {
+                    ((Relocate(std::get<I>(columns_), size_, std::get<I>(columns)), ++relocated), ...);
+                }(Columns{});
+            } catch (...) {
+                [&]<size_t... I>(std::index_sequence<I...>) {
+                    ((I < relocated ? std::destroy_n(std::get<I>(columns), size_), void() : void()), ...);
+                }(Columns{});
+                Deallocate(data);
+                throw;
+            }
+            DestroyRows(0, size_, Columns{});
+            Deallocate(data_);
+            data_ = data;
+            columns_ = columns;
+            capacity_ = capacity;
+        }
+
+        template<typename T>
+        static void Relocate(T* from, size_type count, T* to) {
+            if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+                std::uninitialized_move_n(from, count, to);
+            } else {
+                std::uninitialized_copy_n(from, count, to);
+            }
+        }
+
+        void Grow() {
+            if (size_ == capacity_) {
+                Reallocate(std::max<size_type>(capacity_ * 2, 8));
+            }
+        }
+
+        // Constructs the fields of row size_ one column at a time, undoing the finished ones if one throws.
+        template<typename... Args>
+        reference ConstructRow(Args&&... args) {
+            size_t built = 0;
+            try {
+                [&]<size_t... I>(std::index_sequence<I...>) {
+                    ((std::construct_at(std::get<I>(columns_) + size_, std::forward<Args>(args)), ++built), ...);
+                }(Columns{});
+            } catch (...) {
+                [&]<size_t... I>(std::index_sequence<I...>) {
+                    ((I < built ? std::destroy_at(std::get<I>(columns_) + size_) : void()), ...);
+                }(Columns{});
+                throw;
+            }
+            ++size_;
+            return (*this)[size_ - 1];
+        }
+    public:
+        soa_vector() = default;
+
+        explicit soa_vector(size_type capacity) {
+            reserve(capacity);
+        }
+
+        soa_vector(const soa_vector& other) {
+            reserve(other.size_);
+            for (size_type i = 0; i < other.size_; ++i) {
+                push_back(value_type(other[i]));
+            }
+        }
+
+        soa_vector(soa_vector&& other) noexcept
+                : data_(std::exchange(other.data_, nullptr)),
+                  columns_(std::exchange(other.columns_, {})),
+                  size_(std::exchange(other.size_, 0)),
+                  capacity_(std::exchange(other.capacity_, 0)) {}
+
+        soa_vector& operator=(soa_vector other) noexcept {
+            swap(other);
+            return *this;
+        }
+
+        ~soa_vector() {
+            clear();
+            Deallocate(data_);
+        }
+
+        void swap(soa_vector& other) noexcept {
+            std::swap(data_, other.data_);
+            std::swap(columns_, other.columns_);
+            std::swap(size_, other.size_);
+            std::swap(capacity_, other.capacity_);
+        }
+
+        void reserve(size_type capacity) {
+            if (capacity > capacity_) {
+                Reallocate(capacity);
+            }
+        }
+
+        reference push_back(const value_type& row) {
+            Grow();
+            return std::apply([this](const auto&... fields) { return ConstructRow(fields...); }, row);
+        }
+
+        reference push_back(value_type&& row) {
+            Grow();
+            return std::apply([this](auto&... fields) { return ConstructRow(std::move(fields)...); }, row);
+        }
+
+        // One argument per column, each forwarded to that column's constructor.
+        template<typename... Args>
+            requires (sizeof...(Args) == sizeof...(Ts)) && (std::constructible_from<Ts, Args&&> && ...)
+        reference emplace_back(Args&&... args) {
+            Grow();
+            return ConstructRow(std::forward<Args>(args)...);
+        }
+
+        void pop_back() {
+            if (size_ == 0) {
+                throw std::invalid_argument("The container is already empty");
+            }
+            DestroyRows(size_ - 1, size_, Columns{});
+            --size_;
+        }
+
+        void clear() noexcept {
+            DestroyRows(0, size_, Columns{});
+            size_ = 0;
+        }
+
+        template<size_t I>
+        std::span<column_type<I>> column() noexcept {
+            return {std::get<I>(columns_), size_};
+        }
+
+        template<size_t I>
+        std::span<const column_type<I>> column() const noexcept {
+            return {std::get<I>(columns_), size_};
+        }
+
+        rows_type rows() noexcept {
+            return std::apply([this](auto*... columns) { return rows_type(std::span<Ts>(columns, size_)...); }, columns_);
+        }
+
+        const_rows_type rows() const noexcept {
+            return std::apply([this](auto*... columns) {
+                return const_rows_type(std::span<const Ts>(columns, size_)...);
+            }, columns_);
+        }
+
+        iterator begin() noexcept {
+            return rows().begin();
+        }
+
+        iterator end() noexcept {
+            return rows().end();
+        }
+
+        const_iterator begin() const noexcept {
+            return rows().begin();
+        }
+
+        const_iterator end() const noexcept {
+            return rows().end();
+        }
+
+        reference operator[](size_type n) {
+            if (n >= size_) {
+                throw std::invalid_argument("Index is out of range");
+            }
+            return rows()[n];
+        }
+
+        const_reference operator[](size_type n) const {
+            if (n >= size_) {
+                throw std::invalid_argument("Index is out of range");
+            }
+            return rows()[n];
+        }
+
+        size_type size() const noexcept {
+            return size_;
+        }
+
+        size_type capacity() const noexcept {
+            return capacity_;
+        }
+
+        bool empty() const noexcept {
+            return size_ == 0;
+        }
+    };
+}
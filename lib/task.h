@@ -1,28 +1,35 @@
-#include <iostream>
+#pragma once
 
-template<typename T>
-class XrangeInterface {
-public:
-    virtual size_t operator-(const T& other);
+#include <concepts>
+#include <cstddef>
 
-    virtual bool operator==(const T& other) const;
+namespace extraAlgorithms {
 
-    virtual bool operator>(const T& other) const;
+    // The stepping protocol xrange checks at compile time. It replaces the old virtual XrangeInterface:
+    // a user type only has to provide the operators below, and since nothing is virtual the loop over it
+    // inlines like a loop over int.
 
-    virtual bool operator<(const T& other) const;
+    // value += step moves to the next element.
+    template<typename T>
+    concept XrangeSteppable = std::copyable<T> && requires(T value, const T step) {
+        { value += step } -> std::same_as<T&>;
+    };
 
-    virtual bool operator>=(const T& other) const;
+    // a < b tells in which direction the range runs and where it ends.
+    template<typename T>
+    concept XrangeComparable = requires(const T a, const T b) {
+        { a < b } -> std::convertible_to<bool>;
+    };
 
-    virtual bool operator<=(const T& other) const;
+    template<typename T>
+    concept XrangeValue = XrangeSteppable<T> && XrangeComparable<T>;
 
-    virtual bool operator!=(const T& other) const;
-
-    virtual T& operator++();
-
-    virtual T& operator+=(const T& other);
-
-    virtual T& operator+=(int other);
-
-    virtual T& operator=(int other);
-};
+    // Optional: a - b is the distance in integer units and value += n moves by n units. With these the
+    // element at index i is found in O(1), so xrange over the type is random-access and has an O(1) size.
+    template<typename T>
+    concept XrangeRandomAccess = XrangeValue<T> && requires(const T a, const T b, T value, std::ptrdiff_t n) {
+        { a - b } -> std::convertible_to<std::ptrdiff_t>;
+        value += n;
+    };
 
+}
@@ -1,82 +1,609 @@
+#pragma once
+
 #include <iostream>
+#include <iterator>
+#include <type_traits>
+#include <stdexcept>
+#include <cstdint>
+#include <cmath>
+#include <array>
+#include <span>
+#include <vector>
+#include <utility>
+#include <limits>
+#include <algorithm>
+
+#include "task.h"
 
 namespace extraAlgorithms {
 
+    // How the element at a given index is computed. Arithmetic values are start + index * step.
+    template<typename T>
+    struct XrangeStepping {
+        using step_type = T;
+
+        static constexpr step_type Step(const T&, const T& step) {
+            return step;
+        }
+
+        static constexpr T At(const T& start, const step_type& step, std::ptrdiff_t index) {
+            return static_cast<T>(start + static_cast<T>(index) * step);
+        }
+    };
+
+    // User types that satisfy XrangeRandomAccess keep their step as a number of units, measured once as
+    // (start + step) - start, and jump to any index with a single value += units * index.
+    template<typename T> requires (XrangeRandomAccess<T> && !std::is_arithmetic_v<T>)
+    struct XrangeStepping<T> {
+        using step_type = std::ptrdiff_t;
+
+        static constexpr step_type Step(const T& start, const T& step) {
+            T next = start;
+            next += step;
+            return static_cast<step_type>(next - start);
+        }
+
+        static constexpr T At(const T& start, step_type step, std::ptrdiff_t index) {
+            T value = start;
+            value += static_cast<std::ptrdiff_t>(index * step);
+            return value;
+        }
+    };
+
+    // Arithmetic and XrangeRandomAccess values are computed from the index, so the iterator is random-access
+    // and every jump is O(1). Other value types are stepped with operator+= (see the specialization below).
     template<typename T>
-    class XrangeIterator : public std::iterator_traits<std::input_iterator_tag> {
+    class XrangeIterator {
     public:
         using value_type = T;
         using pointer = T*;
-        using reference = T&;
-        using iterator_category = std::input_iterator_tag;
+        using reference = T;
+        using iterator_category = std::random_access_iterator_tag;
+        using iterator_concept = std::random_access_iterator_tag;
         using difference_type = std::ptrdiff_t;
-        value_type value_ = 0;
-        const value_type step_ = 1;
+        using step_type = typename XrangeStepping<T>::step_type;
+    private:
+        value_type start_{};
+        step_type step_{};
+        difference_type index_ = 0;
     public:
-        XrangeIterator() = default;
+        constexpr XrangeIterator() = default;
 
-        explicit XrangeIterator(value_type value) : value_(value) {}
+        constexpr XrangeIterator(value_type start, step_type step, difference_type index) : start_(start),
+                                                                                            step_(step),
+                                                                                            index_(index) {}
 
-        XrangeIterator(value_type value, value_type step) : value_(value), step_(step) {}
+        constexpr value_type operator*() const {
+            return XrangeStepping<T>::At(start_, step_, index_);
+        }
+
+        constexpr value_type operator[](difference_type n) const {
+            return *(*this + n);
+        }
+
+        constexpr XrangeIterator& operator++() {
+            ++index_;
+            return *this;
+        }
+
+        constexpr XrangeIterator operator++(int) {
+            XrangeIterator tmp = *this;
+            ++index_;
+            return tmp;
+        }
+
+        constexpr XrangeIterator& operator--() {
+            --index_;
+            return *this;
+        }
+
+        constexpr XrangeIterator operator--(int) {
+            XrangeIterator tmp = *this;
+            --index_;
+            return tmp;
+        }
+
+        constexpr XrangeIterator& operator+=(difference_type n) {
+            index_ += n;
+            return *this;
+        }
+
+        constexpr XrangeIterator& operator-=(difference_type n) {
+            index_ -= n;
+            return *this;
+        }
+
+        constexpr XrangeIterator operator+(difference_type n) const {
+            XrangeIterator tmp = *this;
+            return tmp += n;
+        }
+
+        friend constexpr XrangeIterator operator+(difference_type n, const XrangeIterator& it) {
+            return it + n;
+        }
+
+        constexpr XrangeIterator operator-(difference_type n) const {
+            XrangeIterator tmp = *this;
+            return tmp -= n;
+        }
+
+        constexpr difference_type operator-(const XrangeIterator& other) const {
+            return index_ - other.index_;
+        }
+
+        constexpr bool operator==(const XrangeIterator& other) const {
+            return index_ == other.index_;
+        }
+
+        constexpr bool operator!=(const XrangeIterator& other) const {
+            return index_ != other.index_;
+        }
+
+        constexpr bool operator<(const XrangeIterator& other) const {
+            return index_ < other.index_;
+        }
+
+        constexpr bool operator>(const XrangeIterator& other) const {
+            return index_ > other.index_;
+        }
+
+        constexpr bool operator<=(const XrangeIterator& other) const {
+            return index_ <= other.index_;
+        }
+
+        constexpr bool operator>=(const XrangeIterator& other) const {
+            return index_ >= other.index_;
+        }
+    };
+
+    // User types that only know how to add a step are walked forward one step at a time.
+    // The end is still detected by index, which keeps negative and non-unit steps from overrunning.
+    template<typename T> requires (!XrangeRandomAccess<T> && !std::is_arithmetic_v<T>)
+    class XrangeIterator<T> {
+    public:
+        using value_type = T;
+        using pointer = T*;
+        using reference = const T&;
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using step_type = T;
+    private:
+        value_type value_;
+        value_type step_;
+        difference_type index_ = 0;
+    public:
+        XrangeIterator(value_type start, value_type step, difference_type index) : value_(start),
+                                                                                   step_(step),
+                                                                                   index_(index) {}
+
+        reference operator*() const {
+            return value_;
+        }
 
         XrangeIterator& operator++() {
             value_ += step_;
+            ++index_;
             return *this;
         }
 
-        size_t operator-(XrangeIterator& other) {
-            size_t tmp = value_ - other.value_;
-            return tmp / step_ + 1 * (tmp % step_ != 0);
+        XrangeIterator operator++(int) {
+            XrangeIterator tmp = *this;
+            ++*this;
+            return tmp;
         }
 
         bool operator==(const XrangeIterator& other) const {
-            return value_ == other.value_;
+            return index_ == other.index_;
         }
 
-        bool operator>(const XrangeIterator& other) const {
-            return value_ > other.value_;
+        bool operator!=(const XrangeIterator& other) const {
+            return index_ != other.index_;
         }
+    };
+
+    // One fixed-width batch of xrange values. Lanes at and after count lie past the end of the range:
+    // they hold value_type{} and are reported inactive, so kernels can run full-width and mask the tail.
+    template<typename T, size_t N>
+    struct XrangeLane {
+        std::array<T, N> values{};
+        size_t count = 0;
 
-        bool operator<(const XrangeIterator& other) const {
-            return value_ < other.value_;
+        constexpr bool active(size_t lane) const noexcept {
+            return lane < count;
         }
 
-        bool operator!=(const XrangeIterator& other) const {
-            return (!(*this == other) && !(*this > other));
+        constexpr std::array<bool, N> mask() const noexcept {
+            std::array<bool, N> result{};
+            for (size_t lane = 0; lane < N; ++lane) {
+                result[lane] = lane < count;
+            }
+            return result;
         }
 
-        T operator*() {
-            return value_;
+        constexpr const T& operator[](size_t lane) const noexcept {
+            return values[lane];
         }
     };
 
-    template<typename T>
+    template<typename T, size_t N>
+    class XrangeLanes {
+    public:
+        using value_type = XrangeLane<T, N>;
+        using size_type = size_t;
+    private:
+        class LaneIterator {
+        public:
+            using value_type = XrangeLane<T, N>;
+            using reference = XrangeLane<T, N>;
+            using pointer = XrangeLane<T, N>*;
+            using iterator_category = std::input_iterator_tag;
+            using difference_type = std::ptrdiff_t;
+        private:
+            XrangeIterator<T> position_;
+            XrangeIterator<T> last_;
+        public:
+            LaneIterator() = default;
+
+            LaneIterator(XrangeIterator<T> position, XrangeIterator<T> last) : position_(position), last_(last) {}
+
+            value_type operator*() const {
+                value_type lane;
+                const auto remaining = static_cast<size_t>(last_ - position_);
+                if (remaining >= N) {
+                    for (size_t i = 0; i < N; ++i) {
+                        lane.values[i] = position_[static_cast<difference_type>(i)];
+                    }
+                    lane.count = N;
+                } else {
+                    for (size_t i = 0; i < remaining; ++i) {
+                        lane.values[i] = position_[static_cast<difference_type>(i)];
+                    }
+                    lane.count = remaining;
+                }
+                return lane;
+            }
+
+            LaneIterator& operator++() {
+                const auto remaining = last_ - position_;
+                position_ += remaining < static_cast<difference_type>(N) ? remaining : static_cast<difference_type>(N);
+                return *this;
+            }
+
+            LaneIterator operator++(int) {
+                LaneIterator tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            bool operator==(const LaneIterator& other) const {
+                return position_ == other.position_;
+            }
+
+            bool operator!=(const LaneIterator& other) const {
+                return position_ != other.position_;
+            }
+        };
+
+        XrangeIterator<T> first_;
+        XrangeIterator<T> last_;
+    public:
+        using iterator = LaneIterator;
+
+        XrangeLanes(XrangeIterator<T> first, XrangeIterator<T> last) : first_(first), last_(last) {}
+
+        iterator begin() const {
+            return iterator(first_, last_);
+        }
+
+        iterator end() const {
+            return iterator(last_, last_);
+        }
+
+        size_type size() const noexcept {
+            return (static_cast<size_type>(last_ - first_) + N - 1) / N;
+        }
+    };
+
+    struct inclusive_t {
+        explicit inclusive_t() = default;
+    };
+
+    // Tag for xrange(start, end, step, inclusive): end itself is produced when the grid reaches it.
+    inline constexpr inclusive_t inclusive{};
+
+    template<XrangeValue T>
     class xrange {
     public:
         using iterator = XrangeIterator<T>;
+        using const_iterator = XrangeIterator<T>;
         using pointer = T*;
         using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
         using reference = T&;
         using const_reference = const T&;
         using value_type = T;
+        using step_type = typename iterator::step_type;
     private:
-        const iterator iterator_begin_;
-        const iterator iterator_end_;
+        value_type start_;
+        step_type step_;
+        size_type first_ = 0;
+        size_type size_ = 0;
+
+        // Sub-ranges keep the parent's start and step and only move the index window, so every value
+        // of a piece is bit-identical to the same position of the whole range (this matters for floats).
+        constexpr xrange(value_type start, step_type step, size_type first, size_type size) : start_(start),
+                                                                                              step_(step),
+                                                                                              first_(first),
+                                                                                              size_(size) {}
+
+        static constexpr value_type Value(value_type start, value_type step, size_type index) {
+            return XrangeStepping<T>::At(start, step, static_cast<difference_type>(index));
+        }
+
+        // Same as Count, plus end itself when it lies on the grid. Floating-point grids are matched to within
+        // a few ulps, so xrange(0.0, 1.1, 0.1, inclusive) ends at the value closest to 1.1.
+        static constexpr size_type InclusiveCount(value_type start, value_type end, value_type step) {
+            const size_type count = Count(start, end, step);
+            const bool ascending = step > value_type(0);
+            if (ascending ? end < start : start < end) {
+                return count;
+            }
+            if constexpr (std::is_integral_v<value_type>) {
+                return count + (Value(start, step, count) == end ? 1 : 0);
+            } else {
+                const value_type scale = std::max({std::abs(start), std::abs(end), std::abs(step)});
+                const value_type tolerance = 4 * std::numeric_limits<value_type>::epsilon() * scale;
+                return count + (std::abs(Value(start, step, count) - end) <= tolerance ? 1 : 0);
+            }
+        }
+
+        static constexpr size_type Count(value_type start, value_type end, value_type step) {
+            if constexpr (std::is_integral_v<value_type>) {
+                if (step > 0) {
+                    if (end <= start) {
+                        return 0;
+                    }
+                    using wide = std::conditional_t<std::is_signed_v<value_type>, std::intmax_t, std::uintmax_t>;
+                    auto distance = static_cast<std::uintmax_t>(static_cast<wide>(end) - static_cast<wide>(start));
+                    auto stride = static_cast<std::uintmax_t>(step);
+                    return static_cast<size_type>((distance + stride - 1) / stride);
+                }
+                if constexpr (std::is_signed_v<value_type>) {
+                    if (step < 0) {
+                        if (start <= end) {
+                            return 0;
+                        }
+                        auto distance = static_cast<std::uintmax_t>(static_cast<std::intmax_t>(start) -
+                                                                    static_cast<std::intmax_t>(end));
+                        auto stride = static_cast<std::uintmax_t>(-static_cast<std::intmax_t>(step));
+                        return static_cast<size_type>((distance + stride - 1) / stride);
+                    }
+                }
+                throw std::invalid_argument("xrange step must not be zero");
+            } else if constexpr (std::is_floating_point_v<value_type>) {
+                if (step == 0) {
+                    throw std::invalid_argument("xrange step must not be zero");
+                }
+                const value_type steps = std::ceil((end - start) / step);
+                if (!std::isfinite(steps)) {
+                    throw std::invalid_argument("xrange bounds and step must be finite");
+                }
+                // The quotient above is itself rounded, so the estimate is corrected against the exact
+                // values the iterator will produce: every element is strictly before end, and the next one is not.
+                auto before_end = [&](size_type index) {
+                    const value_type value = Value(start, step, index);
+                    return step > 0 ? value < end : value > end;
+                };
+                size_type count = steps > 0 ? static_cast<size_type>(steps) : 0;
+                while (count > 0 && !before_end(count - 1)) {
+                    --count;
+                }
+                while (before_end(count)) {
+                    ++count;
+                }
+                return count;
+            } else if constexpr (XrangeRandomAccess<value_type>) {
+                const std::ptrdiff_t units = XrangeStepping<T>::Step(start, step);
+                const auto distance = static_cast<std::ptrdiff_t>(end - start);
+                if (units == 0) {
+                    throw std::invalid_argument("xrange step must not be zero");
+                }
+                if ((units > 0 && distance <= 0) || (units < 0 && distance >= 0)) {
+                    return 0;
+                }
+                const auto magnitude = static_cast<size_type>(distance > 0 ? distance : -distance);
+                const auto stride = static_cast<size_type>(units > 0 ? units : -units);
+                return (magnitude + stride - 1) / stride;
+            } else {
+                value_type probe = start;
+                probe += step;
+                const bool ascending = start < probe;
+                if (!ascending && !(probe < start)) {
+                    throw std::invalid_argument("xrange step must not be zero");
+                }
+                size_type count = 0;
+                for (value_type value = start; ascending ? value < end : end < value; value += step) {
+                    ++count;
+                }
+                return count;
+            }
+        }
+
     public:
-        explicit xrange(value_type end) : iterator_end_(end) {}
+        explicit constexpr xrange(value_type end) : xrange(value_type(0), end, value_type(1)) {}
 
-        xrange(value_type start, value_type end) : iterator_begin_(start), iterator_end_(end) {}
+        constexpr xrange(value_type start, value_type end) : xrange(start, end, value_type(1)) {}
 
-        xrange(value_type start, value_type end, value_type step) : iterator_begin_(start, step),
-                                                                    iterator_end_(end, step) {}
+        constexpr xrange(value_type start, value_type end, value_type step) : start_(start),
+                                                                              step_(XrangeStepping<T>::Step(start, step)),
+                                                                              size_(Count(start, end, step)) {}
 
-        iterator begin() const {
-            return iterator_begin_;
+        constexpr xrange(value_type start, value_type end, value_type step, inclusive_t)
+        requires std::is_arithmetic_v<value_type>
+                : start_(start), step_(step), size_(InclusiveCount(start, end, step)) {}
+
+        // The range start, start + step, ... with exactly count elements.
+        static constexpr xrange with_count(value_type start, value_type step, size_type count)
+        requires std::is_arithmetic_v<value_type> {
+            return xrange(start, step, 0, count);
         }
 
-        iterator end() const {
-            return iterator_end_;
+        constexpr iterator begin() const {
+            return iterator(start_, step_, static_cast<difference_type>(first_));
+        }
+
+        constexpr iterator end() const {
+            return iterator(start_, step_, static_cast<difference_type>(first_ + size_));
+        }
+
+        constexpr size_type size() const noexcept {
+            return size_;
+        }
+
+        constexpr bool empty() const noexcept {
+            return size_ == 0;
+        }
+
+        constexpr value_type operator[](size_type n) const requires std::is_arithmetic_v<value_type> {
+            return begin()[static_cast<difference_type>(n)];
+        }
+
+        template<size_t N>
+        XrangeLanes<value_type, N> lanes() const requires std::is_arithmetic_v<value_type> {
+            static_assert(N > 0, "lane width must be positive");
+            return XrangeLanes<value_type, N>(begin(), end());
+        }
+
+        // Writes min(size(), out.size()) values and returns how many were written. Every element is
+        // computed from its own index, so there is no loop-carried dependency and the blocked loop
+        // below is turned into vector iota code by the compiler.
+        size_type fill(std::span<value_type> out) const requires std::is_arithmetic_v<value_type> {
+            constexpr size_type kBlock = 64 / sizeof(value_type) > 0 ? 64 / sizeof(value_type) : 1;
+            const size_type count = out.size() < size_ ? out.size() : size_;
+            const value_type start = start_;
+            const value_type step = step_;
+            const size_type first = first_;
+            value_type* data = out.data();
+            size_type i = 0;
+            for (; i + kBlock <= count; i += kBlock) {
+                for (size_type j = 0; j < kBlock; ++j) {
+                    data[i + j] = static_cast<value_type>(start + static_cast<value_type>(first + i + j) * step);
+                }
+            }
+            for (; i < count; ++i) {
+                data[i] = static_cast<value_type>(start + static_cast<value_type>(first + i) * step);
+            }
+            return count;
+        }
+
+        std::vector<value_type> to_vector() const requires std::is_arithmetic_v<value_type> {
+            std::vector<value_type> result(size_);
+            fill(result);
+            return result;
+        }
+
+        // Returns count elements starting at position first (both clamped to the range).
+        constexpr xrange subrange(size_type first, size_type count) const requires std::is_arithmetic_v<value_type> {
+            first = first < size_ ? first : size_;
+            count = count < size_ - first ? count : size_ - first;
+            return xrange(start_, step_, first_ + first, count);
+        }
+
+        // Splits into exactly k consecutive pieces whose sizes differ by at most one.
+        std::vector<xrange> split(size_type k) const requires std::is_arithmetic_v<value_type> {
+            if (k == 0) {
+                throw std::invalid_argument("xrange can not be split into zero parts");
+            }
+            std::vector<xrange> parts;
+            parts.reserve(k);
+            const size_type base = size_ / k;
+            const size_type extra = size_ % k;
+            size_type first = 0;
+            for (size_type i = 0; i < k; ++i) {
+                const size_type count = base + (i < extra ? 1 : 0);
+                parts.push_back(subrange(first, count));
+                first += count;
+            }
+            return parts;
+        }
+
+        // Splits in the ratio left : right, which is what a work-stealing scheduler asks for
+        // when it hands a part of its range to a thief.
+        std::pair<xrange, xrange> proportional_split(size_type left, size_type right) const
+        requires std::is_arithmetic_v<value_type> {
+            if (left + right == 0) {
+                throw std::invalid_argument("xrange proportions must not both be zero");
+            }
+            const auto head = static_cast<size_type>(static_cast<long double>(size_) * left / (left + right));
+            return {subrange(0, head), subrange(head, size_ - head)};
+        }
+    };
+
+    // count values evenly spaced from start to end, like numpy.linspace. With endpoint == false the
+    // last value is one step before end. Values are start + i * step, so there is no accumulated error.
+    template<typename T> requires std::is_floating_point_v<T>
+    xrange<T> linspace(T start, T end, size_t count, bool endpoint = true) {
+        const size_t intervals = endpoint && count > 0 ? count - 1 : count;
+        const T step = intervals > 0 ? (end - start) / static_cast<T>(intervals) : T(0);
+        return xrange<T>::with_count(start, step, count);
+    }
+
+    // A range whose bounds are template arguments. Its size is a compile-time constant, so for_each and
+    // apply expand over std::index_sequence into straight-line code with no loop left at runtime.
+    template<auto Start, decltype(Start) End, decltype(Start) Step = decltype(Start)(1)>
+    requires std::is_arithmetic_v<decltype(Start)>
+    struct ct_xrange {
+        using value_type = decltype(Start);
+        using iterator = XrangeIterator<value_type>;
+        using size_type = size_t;
+
+        static constexpr size_type kSize = xrange<value_type>(Start, End, Step).size();
+
+        template<size_type I>
+        static constexpr value_type kValue = static_cast<value_type>(Start + static_cast<value_type>(I) * Step);
+
+        // Calls f once per element with a std::integral_constant-like value, which converts to value_type
+        // and can also be used as a template argument inside f.
+        template<typename Function>
+        static constexpr void for_each(Function&& f) {
+            [&]<size_type... I>(std::index_sequence<I...>) {
+                (f(std::integral_constant<value_type, kValue<I>>{}), ...);
+            }(std::make_index_sequence<kSize>{});
+        }
+
+        // Calls f(values...) with the whole range as one parameter pack, so folds over it unroll.
+        template<typename Function>
+        static constexpr decltype(auto) apply(Function&& f) {
+            return [&]<size_type... I>(std::index_sequence<I...>) -> decltype(auto) {
+                return f(kValue<I>...);
+            }(std::make_index_sequence<kSize>{});
+        }
+
+        constexpr iterator begin() const {
+            return iterator(Start, Step, 0);
+        }
+
+        constexpr iterator end() const {
+            return iterator(Start, Step, static_cast<std::ptrdiff_t>(kSize));
+        }
+
+        static constexpr size_type size() noexcept {
+            return kSize;
+        }
+
+        static constexpr bool empty() noexcept {
+            return kSize == 0;
+        }
+
+        constexpr value_type operator[](size_type n) const {
+            return begin()[static_cast<std::ptrdiff_t>(n)];
         }
     };
 
+    template<typename T>
+    struct is_ct_xrange : std::false_type {};
+
+    template<auto Start, decltype(Start) End, decltype(Start) Step>
+    struct is_ct_xrange<ct_xrange<Start, End, Step>> : std::true_type {};
+
 }
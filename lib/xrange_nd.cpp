@@ -0,0 +1 @@
+#include "xrange_nd.h"
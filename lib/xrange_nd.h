@@ -0,0 +1,451 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <bit>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <cstdint>
+
+namespace extraAlgorithms {
+
+    enum class Traversal {
+        RowMajor,
+        Tiled,
+        Morton
+    };
+
+    // O(1)-memory generator of D-dimensional coordinates (std::array, so structured bindings work).
+    // Every order is a bijection between a linear index and a coordinate, so iterators are random-access
+    // and the range can be split across threads. Tile sizes are either runtime values or, when given as
+    // template arguments, compile-time constants (such a range is always Tiled).
+    template<size_t D, size_t... Tile>
+    class xrange_nd {
+        static_assert(D > 0, "xrange_nd needs at least one dimension");
+        static_assert(sizeof...(Tile) == 0 || sizeof...(Tile) == D, "tile must have one size per dimension");
+        static_assert(((Tile > 0) && ...), "tile sizes must be positive");
+    public:
+        using value_type = std::array<size_t, D>;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+
+        static constexpr size_t kDefaultTile = 32;
+        static constexpr bool kStaticTile = sizeof...(Tile) == D;
+    private:
+        static constexpr size_t kMaxBits = 64;
+
+        // Everything that maps an index to a coordinate. The range and its iterators share one immutable
+        // copy, so iterators stay valid after the range they came from is gone, e.g. when iterating over a
+        // temporary, and copying an iterator does not copy the Morton tables.
+        struct Layout {
+            value_type extents{};
+            value_type tile{};
+            Traversal order = Traversal::RowMajor;
+            size_type total = 0;
+
+            std::array<unsigned, D> bits{};
+            unsigned max_bits = 0;
+            std::array<uint8_t, kMaxBits> bit_dim{};
+            std::array<uint8_t, kMaxBits> bit_level{};
+
+            constexpr size_t Span(size_t d) const noexcept {
+                if constexpr (kStaticTile) {
+                    constexpr value_type kTile{Tile...};
+                    return kTile[d];
+                } else {
+                    return tile[d];
+                }
+            }
+
+            void BuildMorton() {
+                unsigned total_bits = 0;
+                for (size_t d = 0; d < D; ++d) {
+                    bits[d] = extents[d] > 1 ? static_cast<unsigned>(std::bit_width(extents[d] - 1)) : 0;
+                    max_bits = bits[d] > max_bits ? bits[d] : max_bits;
+                    total_bits += bits[d];
+                }
+                if (total_bits > kMaxBits) {
+                    throw std::invalid_argument("xrange_nd is too large for a 64-bit Morton code");
+                }
+                unsigned position = 0;
+                for (unsigned level = 0; level < max_bits; ++level) {
+                    for (size_t d = D; d-- > 0;) {
+                        if (bits[d] > level) {
+                            bit_dim[position] = static_cast<uint8_t>(d);
+                            bit_level[position] = static_cast<uint8_t>(level);
+                            ++position;
+                        }
+                    }
+                }
+            }
+        };
+
+        std::shared_ptr<const Layout> layout_;
+        size_type first_ = 0;
+        size_type last_ = 0;
+
+        static size_type Volume(const value_type& extents) {
+            size_type volume = 1;
+            for (size_t extent : extents) {
+                volume *= extent;
+            }
+            return volume;
+        }
+
+        xrange_nd(const xrange_nd& other, size_type first, size_type last) : xrange_nd(other) {
+            first_ = first;
+            last_ = last;
+        }
+
+        class NdIterator {
+        public:
+            using value_type = std::array<size_t, D>;
+            using reference = value_type;
+            using pointer = const value_type*;
+            using iterator_category = std::random_access_iterator_tag;
+            using iterator_concept = std::random_access_iterator_tag;
+            using difference_type = std::ptrdiff_t;
+        private:
+            friend class xrange_nd;
+
+            std::shared_ptr<const Layout> layout_;
+            size_type index_ = 0;
+            value_type coords_{};
+            value_type origin_{};
+            value_type limit_{};
+            uint64_t code_ = 0;
+
+            NdIterator(std::shared_ptr<const Layout> layout, size_type index) : layout_(std::move(layout)), index_(index) {
+                if (index_ < layout_->total) {
+                    Locate();
+                }
+            }
+
+            void Locate() {
+                if (layout_->order == Traversal::Morton) {
+                    LocateMorton();
+                } else {
+                    LocateTiled();
+                }
+            }
+
+            // Tiles are visited in row-major order of the tile grid and each tile in row-major order.
+            // All tiles before the current one along a dimension are full, so every level is one division.
+            void LocateTiled() {
+                size_type rest = index_;
+                size_type prefix = 1;
+                value_type heights{};
+                for (size_t d = 0; d < D; ++d) {
+                    size_type suffix = 1;
+                    for (size_t j = d + 1; j < D; ++j) {
+                        suffix *= layout_->extents[j];
+                    }
+                    const size_type band = prefix * layout_->Span(d) * suffix;
+                    const size_type tile = rest / band;
+                    rest -= tile * band;
+                    origin_[d] = tile * layout_->Span(d);
+                    heights[d] = std::min(layout_->Span(d), layout_->extents[d] - origin_[d]);
+                    limit_[d] = origin_[d] + heights[d];
+                    prefix *= heights[d];
+                }
+                for (size_t d = D; d-- > 0;) {
+                    coords_[d] = origin_[d] + rest % heights[d];
+                    rest /= heights[d];
+                }
+            }
+
+            // Descends the Morton tree from the top level, skipping whole children by the number of grid
+            // points they contain, so the k-th point is found without enumerating the padded code space.
+            void LocateMorton() {
+                const auto& bits = layout_->bits;
+                const auto& extents = layout_->extents;
+                size_type rest = index_;
+                value_type low{};
+                uint64_t code = 0;
+                unsigned position = 0;
+                for (unsigned level = 0; level < layout_->max_bits; ++level) {
+                    for (size_t d = 0; d < D; ++d) {
+                        position += bits[d] > level ? 1 : 0;
+                    }
+                }
+                for (unsigned level = layout_->max_bits; level-- > 0;) {
+                    std::array<size_t, D> participating{};
+                    size_t count = 0;
+                    for (size_t d = D; d-- > 0;) {
+                        if (bits[d] > level) {
+                            participating[count++] = d;
+                        }
+                    }
+                    position -= static_cast<unsigned>(count);
+                    const size_t half = size_t(1) << level;
+                    for (uint64_t child = 0; child < (uint64_t(1) << count); ++child) {
+                        size_type points = 1;
+                        for (size_t d = 0; d < D; ++d) {
+                            size_t child_low = low[d];
+                            size_t side = size_t(1) << bits[d];
+                            if (bits[d] > level) {
+                                side = half;
+                                for (size_t i = 0; i < count; ++i) {
+                                    if (participating[i] == d && (child >> i & 1)) {
+                                        child_low += half;
+                                    }
+                                }
+                            }
+                            const size_t inside = extents[d] > child_low ? extents[d] - child_low : 0;
+                            points *= inside < side ? inside : side;
+                        }
+                        if (rest < points) {
+                            for (size_t i = 0; i < count; ++i) {
+                                if (child >> i & 1) {
+                                    low[participating[i]] += half;
+                                    code |= uint64_t(1) << (position + i);
+                                }
+                            }
+                            break;
+                        }
+                        rest -= points;
+                    }
+                }
+                coords_ = low;
+                code_ = code;
+            }
+
+            // Called once the innermost coordinate has left its tile (see operator++).
+            void NextTiled() {
+                coords_[D - 1] = origin_[D - 1];
+                for (size_t d = D - 1; d-- > 0;) {
+                    if (++coords_[d] < limit_[d]) {
+                        return;
+                    }
+                    coords_[d] = origin_[d];
+                }
+                for (size_t d = D; d-- > 0;) {
+                    origin_[d] += layout_->Span(d);
+                    if (origin_[d] < layout_->extents[d]) {
+                        coords_[d] = origin_[d];
+                        limit_[d] = std::min(origin_[d] + layout_->Span(d), layout_->extents[d]);
+                        return;
+                    }
+                    origin_[d] = 0;
+                    coords_[d] = 0;
+                    limit_[d] = std::min(layout_->Span(d), layout_->extents[d]);
+                }
+            }
+
+            // Adding one to a Morton code clears its trailing ones and sets the next bit; each of those
+            // bits belongs to one (dimension, level) pair, so the coordinates follow in amortized O(1).
+            // Codes outside a non-power-of-two grid are skipped.
+            void NextMorton() {
+                bool inside;
+                do {
+                    const auto flips = static_cast<unsigned>(std::countr_one(code_));
+                    for (unsigned position = 0; position < flips; ++position) {
+                        coords_[layout_->bit_dim[position]] -= size_t(1) << layout_->bit_level[position];
+                    }
+                    coords_[layout_->bit_dim[flips]] += size_t(1) << layout_->bit_level[flips];
+                    ++code_;
+                    inside = true;
+                    for (size_t d = 0; d < D; ++d) {
+                        inside = inside && coords_[d] < layout_->extents[d];
+                    }
+                } while (!inside);
+            }
+
+        public:
+            NdIterator() = default;
+
+            value_type operator*() const {
+                return coords_;
+            }
+
+            value_type operator[](difference_type n) const {
+                return *(*this + n);
+            }
+
+            NdIterator& operator++() {
+                ++index_;
+                if (layout_->order != Traversal::Morton) {
+                    if (++coords_[D - 1] < limit_[D - 1] || index_ >= layout_->total) {
+                        return *this;
+                    }
+                    NextTiled();
+                } else if (index_ < layout_->total) {
+                    NextMorton();
+                }
+                return *this;
+            }
+
+            NdIterator operator++(int) {
+                NdIterator tmp = *this;
+                ++*this;
+                return tmp;
+            }
+
+            NdIterator& operator--() {
+                return *this -= 1;
+            }
+
+            NdIterator operator--(int) {
+                NdIterator tmp = *this;
+                *this -= 1;
+                return tmp;
+            }
+
+            NdIterator& operator+=(difference_type n) {
+                index_ = static_cast<size_type>(static_cast<difference_type>(index_) + n);
+                if (index_ < layout_->total) {
+                    Locate();
+                }
+                return *this;
+            }
+
+            NdIterator& operator-=(difference_type n) {
+                return *this += -n;
+            }
+
+            NdIterator operator+(difference_type n) const {
+                NdIterator tmp = *this;
+                return tmp += n;
+            }
+
+            friend NdIterator operator+(difference_type n, const NdIterator& it) {
+                return it + n;
+            }
+
+            NdIterator operator-(difference_type n) const {
+                NdIterator tmp = *this;
+                return tmp -= n;
+            }
+
+            difference_type operator-(const NdIterator& other) const {
+                return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+            }
+
+            bool operator==(const NdIterator& other) const {
+                return index_ == other.index_;
+            }
+
+            bool operator!=(const NdIterator& other) const {
+                return index_ != other.index_;
+            }
+
+            bool operator<(const NdIterator& other) const {
+                return index_ < other.index_;
+            }
+
+            bool operator>(const NdIterator& other) const {
+                return index_ > other.index_;
+            }
+
+            bool operator<=(const NdIterator& other) const {
+                return index_ <= other.index_;
+            }
+
+            bool operator>=(const NdIterator& other) const {
+                return index_ >= other.index_;
+            }
+        };
+
+    public:
+        using iterator = NdIterator;
+        using const_iterator = NdIterator;
+
+        explicit xrange_nd(const value_type& extents,
+                           Traversal order = kStaticTile ? Traversal::Tiled : Traversal::RowMajor) :
+                last_(Volume(extents)) {
+            if (kStaticTile && order != Traversal::Tiled) {
+                throw std::invalid_argument("xrange_nd with compile-time tiles is always tiled");
+            }
+            Layout layout;
+            layout.extents = extents;
+            layout.order = order;
+            layout.total = last_;
+            if (order == Traversal::RowMajor) {
+                layout.tile = extents;
+            } else if (order == Traversal::Tiled) {
+                layout.tile.fill(kDefaultTile);
+            } else {
+                layout.BuildMorton();
+            }
+            layout_ = std::make_shared<const Layout>(layout);
+        }
+
+        xrange_nd(const value_type& extents, const value_type& tile) requires (!kStaticTile) :
+                last_(Volume(extents)) {
+            for (size_t d = 0; d < D; ++d) {
+                if (tile[d] == 0) {
+                    throw std::invalid_argument("tile sizes must be positive");
+                }
+            }
+            Layout layout;
+            layout.extents = extents;
+            layout.tile = tile;
+            layout.order = Traversal::Tiled;
+            layout.total = last_;
+            layout_ = std::make_shared<const Layout>(layout);
+        }
+
+        iterator begin() const {
+            return iterator(layout_, first_);
+        }
+
+        iterator end() const {
+            return iterator(layout_, last_);
+        }
+
+        size_type size() const noexcept {
+            return last_ - first_;
+        }
+
+        bool empty() const noexcept {
+            return first_ == last_;
+        }
+
+        const value_type& extents() const noexcept {
+            return layout_->extents;
+        }
+
+        Traversal order() const noexcept {
+            return layout_->order;
+        }
+
+        value_type operator[](size_type n) const {
+            return begin()[static_cast<difference_type>(n)];
+        }
+
+        // Returns count positions starting at position first (both clamped to the range).
+        xrange_nd subrange(size_type first, size_type count) const {
+            first = first < size() ? first : size();
+            count = count < size() - first ? count : size() - first;
+            return xrange_nd(*this, first_ + first, first_ + first + count);
+        }
+
+        std::vector<xrange_nd> split(size_type k) const {
+            if (k == 0) {
+                throw std::invalid_argument("xrange_nd can not be split into zero parts");
+            }
+            std::vector<xrange_nd> parts;
+            parts.reserve(k);
+            const size_type base = size() / k;
+            const size_type extra = size() % k;
+            size_type first = 0;
+            for (size_type i = 0; i < k; ++i) {
+                const size_type count = base + (i < extra ? 1 : 0);
+                parts.push_back(subrange(first, count));
+                first += count;
+            }
+            return parts;
+        }
+    };
+
+    inline xrange_nd<2> xrange2d(size_t rows, size_t cols, Traversal order = Traversal::RowMajor) {
+        return xrange_nd<2>({rows, cols}, order);
+    }
+
+    inline xrange_nd<2> xrange2d(size_t rows, size_t cols, size_t tile_rows, size_t tile_cols) {
+        return xrange_nd<2>({rows, cols}, {tile_rows, tile_cols});
+    }
+
+}
@@ -1,62 +1,370 @@
+#pragma once
+
+#include <algorithm>
+#include <compare>
+#include <concepts>
+#include <cstdlib>
 #include <iostream>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace extraAlgorithms {
+
+    // Two sequences are zipped into pairs (so value.first / value.second keep working), more into tuples.
+    template<typename... Ts>
+    struct ZipTupleOf {
+        using type = std::tuple<Ts...>;
+    };
+
+    template<typename First, typename Second>
+    struct ZipTupleOf<First, Second> {
+        using type = std::pair<First, Second>;
+    };
+
+    template<typename... Ts>
+    using ZipTuple = typename ZipTupleOf<Ts...>::type;
+
+    template<typename Tuple, size_t N>
+    concept TupleOfSize = requires {
+        requires std::tuple_size<std::remove_cvref_t<Tuple>>::value == N;
+    };
+
+    // One row of a zip: a pair or tuple of references into the sequences. Unlike a plain pair of
+    // references it assigns through even when const and swaps the referenced elements, which is what
+    // lets algorithms such as std::ranges::sort permute several sequences together.
+    template<typename... Ts>
+    class ZipReference : public ZipTuple<Ts...> {
+        using Base = ZipTuple<Ts...>;
+
+        template<typename Tuple, size_t... I>
+        constexpr ZipReference(Tuple&& other, std::index_sequence<I...>)
+                : Base(std::get<I>(std::forward<Tuple>(other))...) {}
+
+        template<typename Tuple, size_t... I>
+        constexpr void Assign(Tuple&& other, std::index_sequence<I...>) const {
+            ((std::get<I>(static_cast<const Base&>(*this)) = std::get<I>(std::forward<Tuple>(other))), ...);
+        }
+
+        template<typename Tuple>
+        static constexpr auto Tie(const Tuple& tuple) {
+            return std::apply([](const auto&... elements) { return std::tie(elements...); }, tuple);
+        }
+
+        template<typename Tuple>
+        static constexpr bool AssignableFrom = TupleOfSize<Tuple, sizeof...(Ts)> &&
+                []<size_t... I>(std::index_sequence<I...>) {
+                    return (std::is_assignable_v<const Ts&, decltype(std::get<I>(std::declval<Tuple>()))> && ...);
+                }(std::index_sequence_for<Ts...>{});
+    public:
+        using Base::Base;
+
+        ZipReference(const ZipReference&) = default;
+
+        ZipReference(ZipReference&&) = default;
+
+        constexpr ZipReference(const Base& other) : Base(other) {}
+
+        // Binds to the elements of another row or of a stored value, e.g. a pair<int, char>& as pair<int&, char&>.
+        template<typename Tuple>
+            requires (!std::same_as<std::remove_cvref_t<Tuple>, ZipReference>) && TupleOfSize<Tuple, sizeof...(Ts)> &&
+                     ([]<size_t... I>(std::index_sequence<I...>) {
+                         return (std::is_constructible_v<Ts, decltype(std::get<I>(std::declval<Tuple>()))> && ...);
+                     }(std::index_sequence_for<Ts...>{}))
+        constexpr ZipReference(Tuple&& other) : ZipReference(std::forward<Tuple>(other), std::index_sequence_for<Ts...>{}) {}
+
+        constexpr const ZipReference& operator=(const ZipReference& other) const
+            requires AssignableFrom<const ZipReference&> {
+            Assign(other, std::index_sequence_for<Ts...>{});
+            return *this;
+        }
+
+        template<typename Tuple>
+            requires (!std::same_as<std::remove_cvref_t<Tuple>, ZipReference>) && AssignableFrom<Tuple>
+        constexpr const ZipReference& operator=(Tuple&& other) const {
+            Assign(std::forward<Tuple>(other), std::index_sequence_for<Ts...>{});
+            return *this;
+        }
+
+        friend constexpr void swap(const ZipReference& first, const ZipReference& second)
+            requires (std::swappable<Ts> && ...) {
+            [&]<size_t... I>(std::index_sequence<I...>) {
+                (std::ranges::swap(std::get<I>(static_cast<const Base&>(first)),
+                                   std::get<I>(static_cast<const Base&>(second))), ...);
+            }(std::index_sequence_for<Ts...>{});
+        }
+
+        // Rows compare element by element with each other and with stored values.
+        template<TupleOfSize<sizeof...(Ts)> Tuple>
+        friend constexpr bool operator==(const ZipReference& first, const Tuple& second) {
+            return Tie(first) == Tie(second);
+        }
+
+        template<TupleOfSize<sizeof...(Ts)> Tuple>
+        friend constexpr auto operator<=>(const ZipReference& first, const Tuple& second) {
+            return Tie(first) <=> Tie(second);
+        }
+    };
+}
+
+template<typename... Ts>
+struct std::tuple_size<extraAlgorithms::ZipReference<Ts...>> : std::integral_constant<size_t, sizeof...(Ts)> {};
+
+template<size_t I, typename... Ts>
+struct std::tuple_element<I, extraAlgorithms::ZipReference<Ts...>> : std::tuple_element<I, std::tuple<Ts...>> {};
+
+// A row and a stored value (or two rows with different qualifiers) share a row of common references,
+// which is what the standard iterator concepts check before sorting through a proxy.
+template<typename... Ts, typename... Us, template<typename> typename TQual, template<typename> typename UQual>
+    requires (sizeof...(Ts) == sizeof...(Us))
+struct std::basic_common_reference<extraAlgorithms::ZipReference<Ts...>, extraAlgorithms::ZipReference<Us...>, TQual, UQual> {
+    using type = extraAlgorithms::ZipReference<std::common_reference_t<TQual<Ts>, UQual<Us>>...>;
+};
+
+template<typename... Ts, typename... Us, template<typename> typename TQual, template<typename> typename UQual>
+    requires (sizeof...(Ts) == sizeof...(Us))
+struct std::basic_common_reference<extraAlgorithms::ZipReference<Ts...>, std::tuple<Us...>, TQual, UQual> {
+    using type = extraAlgorithms::ZipReference<std::common_reference_t<TQual<Ts>, UQual<Us>>...>;
+};
+
+template<typename... Ts, typename... Us, template<typename> typename TQual, template<typename> typename UQual>
+    requires (sizeof...(Ts) == sizeof...(Us))
+struct std::basic_common_reference<std::tuple<Ts...>, extraAlgorithms::ZipReference<Us...>, TQual, UQual> {
+    using type = extraAlgorithms::ZipReference<std::common_reference_t<TQual<Ts>, UQual<Us>>...>;
+};
+
+template<typename T1, typename T2, typename U1, typename U2, template<typename> typename TQual, template<typename> typename UQual>
+struct std::basic_common_reference<extraAlgorithms::ZipReference<T1, T2>, std::pair<U1, U2>, TQual, UQual> {
+    using type = extraAlgorithms::ZipReference<std::common_reference_t<TQual<T1>, UQual<U1>>,
+                                               std::common_reference_t<TQual<T2>, UQual<U2>>>;
+};
+
+template<typename T1, typename T2, typename U1, typename U2, template<typename> typename TQual, template<typename> typename UQual>
+struct std::basic_common_reference<std::pair<T1, T2>, extraAlgorithms::ZipReference<U1, U2>, TQual, UQual> {
+    using type = extraAlgorithms::ZipReference<std::common_reference_t<TQual<T1>, UQual<U1>>,
+                                               std::common_reference_t<TQual<T2>, UQual<U2>>>;
+};
 
 namespace extraAlgorithms {
 
-    template<typename FirstSequence, typename SecondSequence>
+    // zip(a, b, c, ...) walks any number of sequences in step and stops at the end of the shortest one.
+    // Lvalue sequences are referenced, rvalue sequences are moved into the zip, and each step yields
+    // references into the sequences, so nothing is copied and writing through the zip changes them.
+    //
+    // When every sequence is random access the zip keeps the begin of each sequence and a single row
+    // index: the loop tests one counter against size() (the shortest length), rows are reached as
+    // base[index] so the loop can be vectorized, and +=, -, [] and splitting work in O(1).
+    // std::ranges::sort(zip(keys, values)) then sorts the sequences together in place.
+    template<typename... Sequences>
     class zip {
+        static_assert(sizeof...(Sequences) > 0, "zip needs at least one sequence");
     private:
+        // Referenced sequences keep their own constness; sequences owned by the zip are read through const.
+        template<typename Sequence>
+        using SequenceIterator = decltype(std::begin(std::declval<std::conditional_t<std::is_lvalue_reference_v<Sequence>,
+                Sequence, const Sequence&>>()));
+
+        static constexpr bool kRandomAccess = (std::random_access_iterator<SequenceIterator<Sequences>> && ...);
+
+        using Iterators = std::tuple<SequenceIterator<Sequences>...>;
+        using Rows = std::index_sequence_for<Sequences...>;
+
+        // Walks the sequences with one iterator each; used when some sequence has no random access.
         class ZipIterator {
         public:
-            using iterator1 = FirstSequence::iterator;
-            using iterator2 = SecondSequence::iterator;
+            using value_type = ZipTuple<std::iter_value_t<SequenceIterator<Sequences>>...>;
+            using reference = ZipReference<std::iter_reference_t<SequenceIterator<Sequences>>...>;
+            using pointer = void;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = std::forward_iterator_tag;
         private:
-            iterator1 first_iterator;
-            iterator2 second_iterator;
+            Iterators iterators_;
         public:
-            ZipIterator(iterator1 first, iterator2 second) : first_iterator(first), second_iterator(second) {}
+            ZipIterator() = default;
+
+            explicit ZipIterator(Iterators iterators) : iterators_(iterators) {}
 
             constexpr ZipIterator& operator++() {
-                ++first_iterator;
-                ++second_iterator;
+                std::apply([](auto&... iterators) { (++iterators, ...); }, iterators_);
                 return *this;
             }
 
             constexpr ZipIterator operator++(int) {
                 ZipIterator tmp = *this;
-                ++first_iterator;
-                ++second_iterator;
+                ++*this;
                 return tmp;
             }
 
+            // Equal as soon as one of the sequences matches, which is what ends the walk at the shortest one.
+            constexpr bool operator==(const ZipIterator& other) const {
+                return [&]<size_t... I>(std::index_sequence<I...>) {
+                    return ((std::get<I>(iterators_) == std::get<I>(other.iterators_)) || ...);
+                }(Rows{});
+            }
+
             constexpr bool operator!=(const ZipIterator& other) const {
-                return (first_iterator != other.first_iterator) && (second_iterator != other.second_iterator);
+                return !(*this == other);
             }
 
-            constexpr bool operator==(const ZipIterator& other) const {
-                return !(*this != other);
+            constexpr reference operator*() const {
+                return std::apply([](const auto&... iterators) { return reference(*iterators...); }, iterators_);
+            }
+
+            friend constexpr auto iter_move(const ZipIterator& iterator) {
+                return std::apply([](const auto&... iterators) {
+                    return ZipReference<decltype(std::ranges::iter_move(iterators))...>(std::ranges::iter_move(iterators)...);
+                }, iterator.iterators_);
             }
 
-            constexpr auto operator*() {
-                return std::make_pair(*first_iterator, *second_iterator);
+            friend constexpr void iter_swap(const ZipIterator& first, const ZipIterator& second)
+                requires (std::indirectly_swappable<SequenceIterator<Sequences>> && ...) {
+                [&]<size_t... I>(std::index_sequence<I...>) {
+                    (std::ranges::iter_swap(std::get<I>(first.iterators_), std::get<I>(second.iterators_)), ...);
+                }(Rows{});
             }
         };
 
+        // The begin of every sequence plus one row index shared by all of them.
+        class IndexedZipIterator {
+        public:
+            using value_type = ZipTuple<std::iter_value_t<SequenceIterator<Sequences>>...>;
+            using reference = ZipReference<std::iter_reference_t<SequenceIterator<Sequences>>...>;
+            using pointer = void;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = std::random_access_iterator_tag;
+        private:
+            Iterators bases_;
+            difference_type index_ = 0;
+        public:
+            IndexedZipIterator() = default;
+
+            IndexedZipIterator(Iterators bases, difference_type index) : bases_(bases), index_(index) {}
+
+            constexpr reference operator*() const {
+                return std::apply([this](const auto&... bases) { return reference(bases[index_]...); }, bases_);
+            }
+
+            constexpr reference operator[](difference_type n) const {
+                return std::apply([n, this](const auto&... bases) { return reference(bases[index_ + n]...); }, bases_);
+            }
+
+            constexpr IndexedZipIterator& operator++() {
+                ++index_;
+                return *this;
+            }
+
+            constexpr IndexedZipIterator operator++(int) {
+                IndexedZipIterator tmp = *this;
+                ++index_;
+                return tmp;
+            }
+
+            constexpr IndexedZipIterator& operator--() {
+                --index_;
+                return *this;
+            }
+
+            constexpr IndexedZipIterator operator--(int) {
+                IndexedZipIterator tmp = *this;
+                --index_;
+                return tmp;
+            }
+
+            constexpr IndexedZipIterator& operator+=(difference_type n) {
+                index_ += n;
+                return *this;
+            }
+
+            constexpr IndexedZipIterator& operator-=(difference_type n) {
+                index_ -= n;
+                return *this;
+            }
+
+            friend constexpr IndexedZipIterator operator+(IndexedZipIterator iterator, difference_type n) {
+                return iterator += n;
+            }
+
+            friend constexpr IndexedZipIterator operator+(difference_type n, IndexedZipIterator iterator) {
+                return iterator += n;
+            }
+
+            friend constexpr IndexedZipIterator operator-(IndexedZipIterator iterator, difference_type n) {
+                return iterator -= n;
+            }
+
+            friend constexpr difference_type operator-(const IndexedZipIterator& first, const IndexedZipIterator& second) {
+                return first.index_ - second.index_;
+            }
+
+            constexpr bool operator==(const IndexedZipIterator& other) const {
+                return index_ == other.index_;
+            }
+
+            constexpr std::strong_ordering operator<=>(const IndexedZipIterator& other) const {
+                return index_ <=> other.index_;
+            }
+
+            friend constexpr auto iter_move(const IndexedZipIterator& iterator) {
+                return std::apply([&](const auto&... bases) {
+                    return ZipReference<decltype(std::ranges::iter_move(bases))...>(
+                            std::ranges::iter_move(bases + iterator.index_)...);
+                }, iterator.bases_);
+            }
+
+            friend constexpr void iter_swap(const IndexedZipIterator& first, const IndexedZipIterator& second)
+                requires (std::indirectly_swappable<SequenceIterator<Sequences>> && ...) {
+                [&]<size_t... I>(std::index_sequence<I...>) {
+                    (std::ranges::iter_swap(std::get<I>(first.bases_) + first.index_,
+                                            std::get<I>(second.bases_) + second.index_), ...);
+                }(Rows{});
+            }
+        };
+
+        std::tuple<Sequences...> sequences_;
+
+        Iterators Begins() const {
+            return std::apply([](auto&... sequences) { return Iterators(std::begin(sequences)...); }, sequences_);
+        }
     public:
-        using iterator = ZipIterator;
-    private:
-        const iterator iterator_begin_;
-        const iterator iterator_end_;
-    public:
-        zip(FirstSequence& first, SecondSequence& second) : iterator_begin_(std::begin(first), std::begin(second)),
-                                                            iterator_end_(std::end(first), std::end(second)) {}
+        using iterator = std::conditional_t<kRandomAccess, IndexedZipIterator, ZipIterator>;
+        using size_type = size_t;
+
+        explicit zip(Sequences&&... sequences) : sequences_(std::forward<Sequences>(sequences)...) {}
 
         iterator begin() const {
-            return iterator_begin_;
+            if constexpr (kRandomAccess) {
+                return iterator(Begins(), 0);
+            } else {
+                return iterator(Begins());
+            }
         }
 
         iterator end() const {
-            return iterator_end_;
+            if constexpr (kRandomAccess) {
+                return iterator(Begins(), static_cast<std::ptrdiff_t>(size()));
+            } else {
+                return std::apply([](auto&... sequences) { return iterator(Iterators(std::end(sequences)...)); },
+                                  sequences_);
+            }
         }
 
+        // Length of the shortest sequence.
+        size_type size() const requires kRandomAccess {
+            return std::apply([](auto&... sequences) {
+                return std::min({static_cast<size_type>(std::end(sequences) - std::begin(sequences))...});
+            }, sequences_);
+        }
+
+        bool empty() const requires kRandomAccess {
+            return size() == 0;
+        }
+
+        typename iterator::reference operator[](size_type n) const requires kRandomAccess {
+            return begin()[static_cast<std::ptrdiff_t>(n)];
+        }
     };
+
+    template<typename... Sequences>
+    zip(Sequences&&...) -> zip<Sequences...>;
 }
@@ -1,6 +1,20 @@
 #include <gtest/gtest.h>
 #include "lib/ExtraAlgorithms.h"
 #include "lib/Buffer.h"
+#include "lib/xrange_nd.h"
+#include "lib/soa_vector.h"
+#include "lib/SpscBuffer.h"
+#include "lib/BroadcastBuffer.h"
+#include "lib/WindowBuffer.h"
+#include "lib/MirroredBuffer.h"
+#include "lib/Allocators.h"
+
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <numeric>
 
 bool FirstCompareWith(int i) {
     return i < 11;
@@ -26,6 +40,41 @@ bool mod_3(int i) {
     return i % 3 == 0;
 }
 
+struct TicketId {
+    long long value = 0;
+
+    TicketId& operator+=(const TicketId& other) {
+        value += other.value;
+        return *this;
+    }
+
+    TicketId& operator+=(std::ptrdiff_t n) {
+        value += n;
+        return *this;
+    }
+
+    std::ptrdiff_t operator-(const TicketId& other) const {
+        return value - other.value;
+    }
+
+    bool operator<(const TicketId& other) const {
+        return value < other.value;
+    }
+};
+
+struct Version {
+    int major = 0;
+
+    Version& operator+=(const Version& other) {
+        major += other.major;
+        return *this;
+    }
+
+    bool operator<(const Version& other) const {
+        return major < other.major;
+    }
+};
+
 TEST(AlgorithmsTests, all_of_tests_true) {
     std::vector<int> arr = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
     ASSERT_TRUE(extraAlgorithms::all_of(arr.begin(), arr.end(), FirstCompareWith));
@@ -160,6 +209,262 @@ TEST(XrangeTestSuite, MinusStepTest) {
     }
 }
 
+TEST(XrangeTestSuite, SizeTest) {
+    ASSERT_EQ(extraAlgorithms::xrange(4).size(), 4);
+    ASSERT_EQ(extraAlgorithms::xrange(1, 6, 2).size(), 3);
+    ASSERT_EQ(extraAlgorithms::xrange(6, 1, -1).size(), 5);
+    ASSERT_EQ(extraAlgorithms::xrange(10, 0, -3).size(), 4);
+    ASSERT_EQ(extraAlgorithms::xrange(5, 1).size(), 0);
+    ASSERT_EQ(extraAlgorithms::xrange(1.5, 5.5).size(), 4);
+}
+
+TEST(XrangeTestSuite, RandomAccessTest) {
+    auto x = extraAlgorithms::xrange(10, 0, -3);
+    ASSERT_EQ(x.end() - x.begin(), 4);
+    ASSERT_EQ(x.begin()[2], 4);
+    ASSERT_EQ(*(x.end() - 1), 1);
+    ASSERT_EQ(x[3], 1);
+
+    std::vector<int> v(x.begin(), x.end());
+    ASSERT_EQ(v, std::vector<int>({10, 7, 4, 1}));
+    ASSERT_EQ(v.capacity(), 4);
+}
+
+TEST(XrangeTestSuite, LanesTest) {
+    std::vector<int> values;
+    size_t batches = 0;
+    for (const auto& lane : extraAlgorithms::xrange(1, 20, 2).lanes<4>()) {
+        for (size_t i = 0; i < 4; ++i) {
+            if (lane.active(i)) {
+                values.push_back(lane[i]);
+            } else {
+                ASSERT_EQ(lane[i], 0);
+            }
+        }
+        ++batches;
+    }
+    ASSERT_EQ(batches, 3);
+    ASSERT_EQ(values, extraAlgorithms::xrange(1, 20, 2).to_vector());
+}
+
+TEST(XrangeTestSuite, FillTest) {
+    auto x = extraAlgorithms::xrange(100, -100, -3);
+    std::vector<int> expected(x.begin(), x.end());
+    ASSERT_EQ(x.to_vector(), expected);
+
+    std::vector<int> small(10, 0);
+    ASSERT_EQ(x.fill(small), 10);
+    ASSERT_EQ(small, std::vector<int>(expected.begin(), expected.begin() + 10));
+}
+
+TEST(XrangeTestSuite, FloatingCountTest) {
+    auto x = extraAlgorithms::xrange(0.0, 1.1, 0.1);
+    ASSERT_EQ(x.size(), 11);
+    ASSERT_LT(x[10], 1.1);
+    size_t i = 0;
+    for (auto value : extraAlgorithms::xrange(0.0, 1.0, 0.1)) {
+        ASSERT_EQ(value, 0.1 * static_cast<double>(i));
+        ++i;
+    }
+    ASSERT_EQ(i, 10);
+    ASSERT_EQ(extraAlgorithms::xrange(1.0, 0.0, -0.1).size(), 10);
+}
+
+TEST(XrangeTestSuite, InclusiveTest) {
+    ASSERT_EQ(extraAlgorithms::xrange(0.0, 1.1, 0.1, extraAlgorithms::inclusive).size(), 12);
+    ASSERT_EQ(extraAlgorithms::xrange(1, 7, 2, extraAlgorithms::inclusive).to_vector(), std::vector<int>({1, 3, 5, 7}));
+    ASSERT_EQ(extraAlgorithms::xrange(1, 8, 2, extraAlgorithms::inclusive).size(), 4);
+    ASSERT_EQ(extraAlgorithms::xrange(6, 0, -3, extraAlgorithms::inclusive).size(), 3);
+
+    ASSERT_EQ(extraAlgorithms::linspace(0.0, 1.0, 5).to_vector(), std::vector<double>({0, 0.25, 0.5, 0.75, 1}));
+    auto open = extraAlgorithms::linspace(0.0, 1.0, 5, false);
+    ASSERT_EQ(open.size(), 5);
+    ASSERT_DOUBLE_EQ(open[4], 0.8);
+    ASSERT_TRUE(extraAlgorithms::linspace(0.0, 1.0, 0).empty());
+}
+
+TEST(XrangeTestSuite, CompileTimeTest) {
+    static_assert(extraAlgorithms::xrange(0, 10, 3).size() == 4);
+    static_assert(extraAlgorithms::xrange(10, 0, -2)[4] == 2);
+    static_assert(extraAlgorithms::ct_xrange<0, 16>::size() == 16);
+    static_assert(extraAlgorithms::ct_xrange<10, 0, -3>::kValue<3> == 1);
+
+    constexpr auto squares = [] {
+        std::array<int, 8> table{};
+        extraAlgorithms::ct_xrange<0, 8>::for_each([&](auto i) {
+            table[i] = i * i;
+        });
+        return table;
+    }();
+    static_assert(squares[7] == 49);
+
+    static_assert(extraAlgorithms::all_of(extraAlgorithms::ct_xrange<0, 16>{}, [](int i) { return i < 16; }));
+    ASSERT_TRUE(extraAlgorithms::any_of(extraAlgorithms::ct_xrange<0, 16, 5>{}, [](int i) { return i == 15; }));
+    ASSERT_TRUE(extraAlgorithms::none_of(extraAlgorithms::ct_xrange<1, 16>{}, ThirdCompareWith));
+    ASSERT_TRUE(extraAlgorithms::one_of(extraAlgorithms::ct_xrange<0, 16>{}, ThirdCompareWith));
+    ASSERT_FALSE(extraAlgorithms::one_of(extraAlgorithms::ct_xrange<0, 16>{}, mod_3));
+
+    std::vector<int> arr = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    ASSERT_TRUE(extraAlgorithms::all_of(arr, FirstCompareWith));
+    ASSERT_TRUE(extraAlgorithms::one_of(extraAlgorithms::xrange(0, 10), ThirdCompareWith));
+}
+
+TEST(XrangeTestSuite, SteppingProtocolTest) {
+    static_assert(extraAlgorithms::XrangeRandomAccess<TicketId>);
+    static_assert(extraAlgorithms::XrangeValue<Version> && !extraAlgorithms::XrangeRandomAccess<Version>);
+    static_assert(!extraAlgorithms::XrangeValue<std::vector<int>>);
+
+    auto tickets = extraAlgorithms::xrange(TicketId{100}, TicketId{80}, TicketId{-5});
+    ASSERT_EQ(tickets.size(), 4);
+    ASSERT_EQ(tickets.end() - tickets.begin(), 4);
+    ASSERT_EQ(tickets.begin()[3].value, 85);
+
+    std::vector<int> versions;
+    for (const auto& version : extraAlgorithms::xrange(Version{1}, Version{10}, Version{4})) {
+        versions.push_back(version.major);
+    }
+    ASSERT_EQ(versions, std::vector<int>({1, 5, 9}));
+}
+
+TEST(XrangeTestSuite, SplitTest) {
+    auto x = extraAlgorithms::xrange(20, -3, -2);
+    auto parts = x.split(4);
+    ASSERT_EQ(parts.size(), 4);
+    std::vector<int> joined;
+    for (const auto& part : parts) {
+        ASSERT_TRUE(part.size() == 3 || part.size() == 2);
+        joined.insert(joined.end(), part.begin(), part.end());
+    }
+    ASSERT_EQ(joined, x.to_vector());
+
+    auto d = extraAlgorithms::xrange(0.0, 1.0, 0.1);
+    auto [head, tail] = d.proportional_split(3, 7);
+    ASSERT_EQ(head.size(), 3);
+    ASSERT_EQ(tail.size(), 7);
+    ASSERT_EQ(tail[4], d[7]);
+}
+
+TEST(XrangeTestSuite, ParallelForTest) {
+    using extraAlgorithms::Schedule;
+    auto x = extraAlgorithms::xrange(1000, -1000, -3);
+    const long long expected = std::accumulate(x.begin(), x.end(), 0LL);
+    for (auto schedule : {Schedule::Static, Schedule::Dynamic, Schedule::Guided}) {
+        std::atomic<long long> sum = 0;
+        std::atomic<size_t> calls = 0;
+        extraAlgorithms::parallel_for(x, [&](int i) {
+            sum += i;
+            ++calls;
+        }, 16, schedule, 4);
+        ASSERT_EQ(sum, expected);
+        ASSERT_EQ(calls, x.size());
+    }
+}
+
+TEST(XrangeNdTestSuite, RowMajorTest) {
+    std::vector<std::array<size_t, 2>> expected;
+    for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 4; ++j) {
+            expected.push_back({i, j});
+        }
+    }
+    auto grid = extraAlgorithms::xrange2d(3, 4);
+    ASSERT_EQ((std::vector<std::array<size_t, 2>>(grid.begin(), grid.end())), expected);
+    ASSERT_EQ(grid[6], (std::array<size_t, 2>{1, 2}));
+}
+
+TEST(XrangeNdTestSuite, TiledTest) {
+    auto grid = extraAlgorithms::xrange2d(5, 7, 2, 3);
+    std::vector<std::array<size_t, 2>> visited(grid.begin(), grid.end());
+    ASSERT_EQ(visited.size(), 35);
+    ASSERT_EQ(visited[0], (std::array<size_t, 2>{0, 0}));
+    ASSERT_EQ(visited[3], (std::array<size_t, 2>{1, 0}));
+    ASSERT_EQ(visited[6], (std::array<size_t, 2>{0, 3}));
+    for (size_t k = 0; k < visited.size(); ++k) {
+        ASSERT_EQ(grid[k], visited[k]);
+    }
+    std::sort(visited.begin(), visited.end());
+    ASSERT_EQ(std::adjacent_find(visited.begin(), visited.end()), visited.end());
+
+    extraAlgorithms::xrange_nd<2, 2, 3> fixed({5, 7});
+    ASSERT_TRUE(std::equal(fixed.begin(), fixed.end(), grid.begin(), grid.end()));
+}
+
+TEST(XrangeNdTestSuite, MortonTest) {
+    auto square = extraAlgorithms::xrange2d(2, 2, extraAlgorithms::Traversal::Morton);
+    std::vector<std::array<size_t, 2>> order(square.begin(), square.end());
+    ASSERT_EQ(order, (std::vector<std::array<size_t, 2>>{{0, 0}, {0, 1}, {1, 0}, {1, 1}}));
+
+    extraAlgorithms::xrange_nd<3> cube({3, 5, 2}, extraAlgorithms::Traversal::Morton);
+    std::vector<std::array<size_t, 3>> visited(cube.begin(), cube.end());
+    ASSERT_EQ(visited.size(), 30);
+    for (size_t k = 0; k < visited.size(); ++k) {
+        ASSERT_EQ(cube[k], visited[k]);
+    }
+    std::sort(visited.begin(), visited.end());
+    ASSERT_EQ(std::adjacent_find(visited.begin(), visited.end()), visited.end());
+    ASSERT_EQ(visited.back(), (std::array<size_t, 3>{2, 4, 1}));
+}
+
+TEST(XrangeNdTestSuite, SplitTest) {
+    auto grid = extraAlgorithms::xrange2d(6, 9, extraAlgorithms::Traversal::Morton);
+    auto parts = grid.split(4);
+    std::vector<std::array<size_t, 2>> joined;
+    for (const auto& part : parts) {
+        joined.insert(joined.end(), part.begin(), part.end());
+    }
+    ASSERT_TRUE(std::equal(joined.begin(), joined.end(), grid.begin(), grid.end()));
+}
+
+TEST(XrangeNdTestSuite, TemporaryRangeTest) {
+    size_t visited = 0;
+    for (auto [i, j] : extraAlgorithms::xrange2d(5, 7, 2, 3)) {
+        ASSERT_TRUE(i < 5 && j < 7);
+        ++visited;
+    }
+    ASSERT_EQ(visited, 35);
+    auto it = extraAlgorithms::xrange2d(4, 4, extraAlgorithms::Traversal::Morton).begin();
+    ++it;
+    ++it;
+    ASSERT_EQ(*it, (std::array<size_t, 2>{1, 0}));
+    ASSERT_EQ(it[13], (std::array<size_t, 2>{3, 3}));
+}
+
+TEST(PipelineTestSuite, FusedChainTest) {
+    using namespace extraAlgorithms;
+    auto chain = xrange(0, 100) | filter([](int i) { return i % 3 == 0; }) | transform([](int i) { return i * 2; })
+                 | take(5);
+    ASSERT_EQ((std::vector<int>(chain.begin(), chain.end())), std::vector<int>({0, 6, 12, 18, 24}));
+    ASSERT_TRUE(all_of(chain, mod_2));
+    ASSERT_TRUE(one_of(chain, ThirdCompareWith));
+}
+
+TEST(PipelineTestSuite, RandomAccessTest) {
+    using namespace extraAlgorithms;
+    std::vector<int> values = {5, 6, 7, 8, 9, 10, 11};
+    auto view = values | transform([](int i) { return i * 10; }) | stride(3);
+    ASSERT_EQ(view.size(), 3);
+    ASSERT_EQ(view.end() - view.begin(), 3);
+    ASSERT_EQ(view.begin()[2], 110);
+
+    auto head = xrange(0, 1000000) | take(4);
+    ASSERT_EQ(head.size(), 4);
+    ASSERT_EQ(*(head.end() - 1), 3);
+}
+
+TEST(PipelineTestSuite, EnumerateTest) {
+    using namespace extraAlgorithms;
+    std::vector<int> values = {4, 8, 15, 16, 23, 42};
+    for (auto [index, value] : values | enumerate) {
+        value += static_cast<int>(index);
+    }
+    ASSERT_EQ(values, std::vector<int>({4, 9, 17, 19, 27, 47}));
+
+    std::list<int> list = {1, 2, 3, 4, 5};
+    auto odd = list | stride(2) | enumerate;
+    std::vector<std::pair<size_t, int>> result(odd.begin(), odd.end());
+    ASSERT_EQ(result, (std::vector<std::pair<size_t, int>>{{0, 1}, {1, 3}, {2, 5}}));
+}
+
 TEST(ZipTest, LessTest) {
     std::vector<int> l = {6, 7, 8};
     std::vector<char> v = {'a', 'b', 'c', 'd'};
@@ -195,3 +500,1090 @@ TEST(ZipTest, MoreTest) {
         i++;
     }
 }
+
+TEST(ZipTest, VariadicTest) {
+    std::vector<int> ids = {1, 2, 3, 4};
+    const std::list<std::string> names = {"one", "two", "three"};
+    std::vector<double> weights = {0.5, 1.5, 2.5, 3.5, 4.5};
+
+    size_t rows = 0;
+    for (auto [id, name, weight] : extraAlgorithms::zip(ids, names, weights)) {
+        ASSERT_EQ(id, ids[rows]);
+        ASSERT_EQ(weight, weights[rows]);
+        ASSERT_EQ(&name, &*std::next(names.begin(), static_cast<std::ptrdiff_t>(rows)));
+        ++rows;
+    }
+    ASSERT_EQ(rows, 3);
+}
+
+TEST(ZipTest, WriteThroughTest) {
+    std::vector<int> keys = {1, 2, 3};
+    std::vector<char> values = {'a', 'b', 'c'};
+    for (auto value : extraAlgorithms::zip(keys, values)) {
+        value.first *= 10;
+        value.second = static_cast<char>(std::toupper(value.second));
+    }
+    ASSERT_EQ(keys, std::vector<int>({10, 20, 30}));
+    ASSERT_EQ(values, std::vector<char>({'A', 'B', 'C'}));
+
+    std::vector<int> squares;
+    for (auto [i, key] : extraAlgorithms::zip(extraAlgorithms::xrange(5), std::vector<int>{0, 1, 4, 9})) {
+        squares.push_back(i * i - key);
+    }
+    ASSERT_EQ(squares, std::vector<int>({0, 0, 0, 0}));
+}
+
+TEST(ZipTest, SortTogetherTest) {
+    std::vector<int> keys = {4, 1, 3, 5, 2};
+    std::vector<std::string> names = {"four", "one", "three", "five", "two"};
+    std::ranges::sort(extraAlgorithms::zip(keys, names));
+    ASSERT_EQ(keys, std::vector<int>({1, 2, 3, 4, 5}));
+    ASSERT_EQ(names, std::vector<std::string>({"one", "two", "three", "four", "five"}));
+
+    std::vector<double> weights = {0.1, 0.2, 0.3, 0.4, 0.5};
+    auto rows = extraAlgorithms::zip(keys, names, weights);
+    std::ranges::sort(rows, std::ranges::greater{});
+    ASSERT_EQ(keys, std::vector<int>({5, 4, 3, 2, 1}));
+    ASSERT_EQ(weights, std::vector<double>({0.5, 0.4, 0.3, 0.2, 0.1}));
+    ASSERT_EQ(names.front(), "five");
+}
+
+TEST(ZipTest, SortBufferColumnTest) {
+    // Shift the head forward so that the ring of the buffer wraps around the end of its storage.
+    ExtBuffer<int> keys = {9, 9, 9, 9, 9};
+    for (int i = 0; i < 4; ++i) {
+        keys.pop_front();
+    }
+    for (int key : {7, 3, 8, 1, 6, 2, 5, 4}) {
+        keys.push_back(key);
+    }
+    std::vector<int> payload = {90, 70, 30, 80, 10, 60, 20, 50, 40};
+    static_assert(std::random_access_iterator<ExtBuffer<int>::iterator>);
+
+    auto rows = extraAlgorithms::zip(keys, payload);
+    std::ranges::sort(rows);
+    ASSERT_EQ(std::ranges::distance(rows), 9);
+    for (size_t i = 0; i < 9; ++i) {
+        ASSERT_EQ(keys[i], payload[i] / 10);
+    }
+    ASSERT_TRUE(std::ranges::is_sorted(payload));
+}
+
+TEST(ZipTest, RandomAccessTest) {
+    std::vector<int> a = {0, 1, 2, 3, 4, 5, 6};
+    std::vector<int> b = {0, 10, 20, 30, 40};
+    auto rows = extraAlgorithms::zip(a, b);
+    static_assert(std::random_access_iterator<decltype(rows.begin())>);
+    ASSERT_EQ(rows.size(), 5);
+    ASSERT_EQ(rows.end() - rows.begin(), 5);
+    ASSERT_EQ(rows[3].second, 30);
+
+    auto it = rows.begin();
+    it += 4;
+    ASSERT_EQ((*it).first, 4);
+    ASSERT_EQ(it[-2].second, 20);
+    ASSERT_TRUE(rows.begin() < it && it < rows.end());
+
+    // Rows can be split by index, so a parallel loop can walk disjoint parts of the zip.
+    std::vector<int> c(5);
+    auto columns = extraAlgorithms::zip(a, b, c);
+    extraAlgorithms::parallel_for(extraAlgorithms::xrange(columns.size()), [&](size_t i) {
+        auto [x, y, z] = columns[i];
+        z = x + y;
+    }, 1, extraAlgorithms::Schedule::Static, 3);
+    ASSERT_EQ(c, std::vector<int>({0, 11, 22, 33, 44}));
+}
+
+TEST(SoaVectorTestSuite, ColumnsTest) {
+    extraAlgorithms::soa_vector<int, double, std::string> particles;
+    for (int i = 0; i < 100; ++i) {
+        particles.emplace_back(i, i * 0.5, std::to_string(i));
+    }
+    ASSERT_EQ(particles.size(), 100);
+    ASSERT_GE(particles.capacity(), 100);
+
+    auto ids = particles.column<0>();
+    auto masses = particles.column<1>();
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(ids.data()) % extraAlgorithms::kColumnAlignment, 0);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(masses.data()) % extraAlgorithms::kColumnAlignment, 0);
+    ASSERT_EQ(std::accumulate(ids.begin(), ids.end(), 0), 4950);
+    ASSERT_EQ(masses[10], 5.0);
+    ASSERT_EQ(particles.column<2>()[42], "42");
+
+    ASSERT_TRUE(extraAlgorithms::all_of(particles.column<0>(), [](int id) { return id >= 0; }));
+    ASSERT_TRUE(extraAlgorithms::one_of(particles.rows(), [](const auto& row) { return std::get<2>(row) == "7"; }));
+    ASSERT_THROW(particles[100], std::invalid_argument);
+}
+
+TEST(SoaVectorTestSuite, RowsTest) {
+    extraAlgorithms::soa_vector<int, char> table;
+    table.reserve(4);
+    table.push_back({3, 'c'});
+    table.push_back({1, 'a'});
+    table.emplace_back(2, 'b');
+    auto [key, tag] = table[2];
+    ASSERT_EQ(key, 2);
+    ASSERT_EQ(tag, 'b');
+
+    std::ranges::sort(table);
+    ASSERT_EQ(table.column<1>()[0], 'a');
+    ASSERT_EQ(table.column<1>()[2], 'c');
+    for (auto row : table) {
+        row.first *= 10;
+    }
+    ASSERT_EQ(table[1].first, 20);
+
+    extraAlgorithms::soa_vector<int, char> copy = table;
+    table.pop_back();
+    ASSERT_EQ(copy.size(), 3);
+    ASSERT_EQ(table.size(), 2);
+    ASSERT_EQ(copy[2].second, 'c');
+}
+
+TEST(ZipKernelTestSuite, ReduceTest) {
+    std::vector<double> a(1000);
+    std::vector<double> b(1000);
+    for (size_t i = 0; i < a.size(); ++i) {
+        a[i] = static_cast<double>(i % 7);
+        b[i] = static_cast<double>(i % 5) * 0.25;
+    }
+    double expected = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        expected += a[i] * b[i];
+    }
+
+    ASSERT_EQ(extraAlgorithms::zip_reduce(0.0, [](double sum, double x, double y) { return sum + x * y; }, a, b), expected);
+    ASSERT_EQ(extraAlgorithms::zip_reduce(0.0, std::plus<>{}, std::multiplies<>{}, a, b), expected);
+
+    std::list<int> left = {1, 2, 3, 4};
+    std::vector<int> right = {1, 0, 3, 0, 5};
+    ASSERT_EQ(extraAlgorithms::zip_reduce(0, std::plus<>{}, [](int x, int y) { return x == y ? 1 : 0; }, left, right), 2);
+}
+
+TEST(ZipKernelTestSuite, ParallelReduceTest) {
+    std::vector<float> a(100000);
+    std::vector<float> b(100000);
+    for (size_t i = 0; i < a.size(); ++i) {
+        a[i] = 1.0f / static_cast<float>(i + 1);
+        b[i] = static_cast<float>(i % 13);
+    }
+    const float sequential = extraAlgorithms::zip_reduce(0.0f, std::plus<>{}, std::multiplies<>{}, a, b);
+    for (size_t threads : {1, 2, 3, 8}) {
+        ASSERT_EQ(extraAlgorithms::zip_reduce(extraAlgorithms::Parallel{threads}, 0.0f, std::plus<>{}, std::multiplies<>{}, a, b),
+                  sequential);
+    }
+    const float fast = extraAlgorithms::zip_reduce(extraAlgorithms::Parallel{4, extraAlgorithms::Reduction::Fast},
+                                                   0.0f, std::plus<>{}, std::multiplies<>{}, a, b);
+    ASSERT_NEAR(fast, sequential, 1e-3f * sequential);
+}
+
+TEST(ZipKernelTestSuite, TransformTest) {
+    std::vector<int> a = {1, 2, 3, 4, 5};
+    std::vector<int> b = {10, 20, 30, 40};
+    std::vector<int> out(4);
+    auto last = extraAlgorithms::zip_transform(out.begin(), std::plus<>{}, a, b);
+    ASSERT_EQ(last, out.end());
+    ASSERT_EQ(out, std::vector<int>({11, 22, 33, 44}));
+
+    std::vector<long> squares;
+    extraAlgorithms::zip_transform(std::back_inserter(squares), [](int x) { return long(x) * x; }, std::list<int>{1, 2, 3});
+    ASSERT_EQ(squares, std::vector<long>({1, 4, 9}));
+
+    std::vector<double> big(50000, 2.0);
+    std::vector<double> scaled(big.size());
+    extraAlgorithms::zip_transform(extraAlgorithms::Parallel{3}, scaled.begin(), [](double x, double y) { return x * y; },
+                                   big, big);
+    ASSERT_TRUE(std::ranges::all_of(scaled, [](double x) { return x == 4.0; }));
+}
+
+TEST(BufferTestSuite, MoveTest) {
+    ExtBuffer<std::string> lines;
+    std::string line(100, 'x');
+    lines.push_back(std::move(line));
+    ASSERT_TRUE(line.empty());
+    lines.emplace_back(3, 'y');
+    for (int i = 0; i < 50; ++i) {
+        lines.push_back(lines[0]);
+    }
+    ASSERT_EQ(lines.size(), 52);
+    ASSERT_EQ(lines[1], "yyy");
+    ASSERT_EQ(lines[51], std::string(100, 'x'));
+
+    const std::string* first = &lines[0];
+    ExtBuffer<std::string> moved = std::move(lines);
+    ASSERT_EQ(&moved[0], first);
+    ASSERT_EQ(moved.size(), 52);
+    ASSERT_TRUE(lines.empty());
+    lines = std::move(moved);
+    ASSERT_EQ(&lines[0], first);
+    ExtBuffer<std::string> copy_of_moved = moved;
+    ASSERT_TRUE(copy_of_moved.empty());
+    copy_of_moved.push_back("z");
+    moved = copy_of_moved;
+    ASSERT_EQ(moved[0], "z");
+    Buffer<int> ring = {1, 2};
+    Buffer<int> taken = std::move(ring);
+    Buffer<int> copy_of_ring(ring);
+    ASSERT_TRUE(copy_of_ring.empty());
+    static_assert(std::is_nothrow_move_constructible_v<ExtBuffer<std::string>>);
+    static_assert(std::is_nothrow_move_assignable_v<Buffer<std::string>>);
+}
+
+TEST(BufferTestSuite, EmptyRingTest) {
+    Buffer<int> none;
+    Buffer<int> copy(none);
+    ASSERT_TRUE(copy.empty());
+    Buffer<int> assigned(4);
+    assigned.push_back(1);
+    assigned = none;
+    ASSERT_TRUE(assigned.empty());
+
+    ExtBuffer<int> nothing;
+    nothing.pop_front(0);
+    std::vector<int> out(3);
+    ASSERT_EQ(nothing.read_into(out), 0);
+    ExtBuffer<int> copied(nothing);
+    copied.push_back(5);
+    ASSERT_EQ(copied[0], 5);
+}
+
+TEST(BufferTestSuite, MoveOnlyTest) {
+    ExtBuffer<std::unique_ptr<int>> owners;
+    for (int i = 0; i < 20; ++i) {
+        owners.emplace_back(std::make_unique<int>(i));
+    }
+    ASSERT_EQ(*owners[19], 19);
+    owners.pop_front();
+    ASSERT_EQ(*owners[0], 1);
+
+    Buffer<std::string> recent(3);
+    for (const char* word : {"a", "b", "c", "d", "e"}) {
+        recent.emplace_back(word);
+    }
+    ASSERT_EQ(recent.size(), 3);
+    ASSERT_EQ(recent[0], "c");
+    ASSERT_EQ(recent[2], "e");
+    Buffer<std::string> taken(std::move(recent));
+    ASSERT_EQ(taken[1], "d");
+}
+
+size_t GrowByQuarter(size_t capacity, size_t) {
+    return capacity + capacity / 4 + 1;
+}
+
+TEST(BufferTestSuite, GrowthPolicyTest) {
+    ExtBuffer<int, std::allocator<int>, AdditiveGrowth<10>> additive;
+    for (int i = 0; i < 25; ++i) {
+        additive.push_back(i);
+    }
+    ASSERT_EQ(additive.capacity(), 30);
+
+    ExtBuffer<int, std::allocator<int>, FactorGrowth<3, 2>> factor;
+    factor.reserve(4);
+    for (int i = 0; i < 5; ++i) {
+        factor.push_back(i);
+    }
+    ASSERT_EQ(factor.capacity(), 6);
+
+    ExtBuffer<int, std::allocator<int>, CallbackGrowth<&GrowByQuarter>> callback;
+    callback.reserve(8);
+    for (int i = 0; i < 9; ++i) {
+        callback.push_back(i);
+    }
+    ASSERT_EQ(callback.capacity(), 11);
+    ASSERT_EQ(callback[8], 8);
+}
+
+TEST(BufferTestSuite, ReserveTest) {
+    ExtBuffer<std::string> words;
+    words.reserve(6);
+    ASSERT_EQ(words.capacity(), 6);
+    for (const char* word : {"x", "y", "a", "b", "c"}) {
+        words.push_back(word);
+    }
+    words.pop_front();
+    words.pop_front();
+    words.push_back("d");
+    words.push_back("e");  // wraps around the end of the storage
+    words.reserve(20);
+    ASSERT_EQ(words.capacity(), 20);
+    words.shrink_to_fit();
+    ASSERT_EQ(words.capacity(), 5);
+    for (size_t i = 0; i < words.size(); ++i) {
+        ASSERT_EQ(words[i], std::string(1, static_cast<char>('a' + i)));
+    }
+}
+
+TEST(BufferTestSuite, MappedGrowthTest) {
+    const size_t count = kMappedBufferBytes / sizeof(int64_t) + 64;
+    ExtBuffer<int64_t> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        values.push_back(static_cast<int64_t>(i));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        values.pop_front();
+    }
+    for (size_t i = count; i < count + 500; ++i) {
+        values.push_back(static_cast<int64_t>(i));
+    }
+    values.reserve(count + 200);
+    values.push_back(static_cast<int64_t>(count + 500));
+    ASSERT_EQ(values.size(), count - 499);
+    int64_t expected = 1000;
+    for (int64_t value : values) {
+        ASSERT_EQ(value, expected++);
+    }
+}
+
+TEST(BufferTestSuite, InsertEraseTest) {
+    ExtBuffer<std::string> buffer = {"a", "b", "c", "d", "e", "f"};
+    buffer.pop_front();
+    buffer.push_back("g");
+    buffer.erase(1);
+    ASSERT_EQ(buffer[1], "d");
+    auto it = buffer.insert(4, {"x", "y"});
+    ASSERT_EQ(*it, "x");
+    buffer.insert(0, 2, "z");
+    std::vector<std::string> extra = {"m", "n"};
+    buffer.insert(buffer.size(), extra.begin(), extra.end());
+    auto next = buffer.erase(buffer.begin() + 2, buffer.begin() + 4);
+    ASSERT_EQ(*next, "e");
+    ASSERT_EQ(buffer.erase_if([](const std::string& s) { return s == "z" || s == "n"; }), 3);
+    ASSERT_EQ(std::vector<std::string>(buffer.begin(), buffer.end()),
+              std::vector<std::string>({"e", "f", "x", "y", "g", "m"}));
+
+    auto same = buffer.insert(1, extra.end(), extra.end());
+    ASSERT_EQ(*same, "f");
+    buffer.insert(0, 0, "q");
+    ASSERT_EQ(std::vector<std::string>(buffer.begin(), buffer.end()),
+              std::vector<std::string>({"e", "f", "x", "y", "g", "m"}));
+    ExtBuffer<std::vector<int>> rows = {{1}, {1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    rows.insert(1, 0, std::vector<int>());
+    ASSERT_EQ(rows[1].size(), 3);
+    ASSERT_EQ(rows[3], std::vector<int>({7, 8, 9}));
+}
+
+TEST(BufferTestSuite, InsertEraseRandomTest) {
+    ExtBuffer<std::string> buffer;
+    std::deque<std::string> expected;
+    uint32_t seed = 12345;
+    auto random = [&](uint32_t bound) {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) % bound;
+    };
+    for (int step = 0; step < 3000; ++step) {
+        const size_t size = expected.size();
+        const uint32_t action = random(6);
+        if (action == 0 || size == 0) {
+            const size_t position = random(static_cast<uint32_t>(size + 1));
+            const size_t count = random(4);
+            const std::string value = std::to_string(step);
+            buffer.insert(position, count, value);
+            if (count != 0) {  // libstdc++'s deque moves elements onto themselves for an empty insert
+                expected.insert(expected.begin() + position, count, value);
+            }
+        } else if (action == 1) {
+            const size_t first = random(static_cast<uint32_t>(size));
+            const size_t last = first + random(static_cast<uint32_t>(size - first + 1));
+            buffer.erase(buffer.begin() + first, buffer.begin() + last);
+            expected.erase(expected.begin() + first, expected.begin() + last);
+        } else if (action == 2) {
+            const size_t index = random(static_cast<uint32_t>(size));
+            buffer.erase(index);
+            expected.erase(expected.begin() + index);
+        } else if (action == 3) {
+            buffer.pop_front();
+            expected.pop_front();
+        } else {
+            buffer.push_back(std::to_string(step));
+            expected.push_back(std::to_string(step));
+        }
+        ASSERT_EQ(buffer.size(), expected.size());
+    }
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(), buffer.begin()));
+    buffer.erase_if([](const std::string& s) { return s.back() == '7'; });
+    std::erase_if(expected, [](const std::string& s) { return s.back() == '7'; });
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(), buffer.begin()));
+}
+
+// Counts its live instances; copies throw once `copies_left` runs out.
+struct Tracked {
+    static inline int live = 0;
+    static inline int copies_left = 0;
+    int value;
+
+    Tracked(int v) : value(v) {
+        ++live;
+    }
+
+    Tracked(const Tracked& other) : value(other.value) {
+        if (copies_left-- == 0) {
+            throw std::runtime_error("copy failed");
+        }
+        ++live;
+    }
+
+    Tracked(Tracked&& other) noexcept : value(other.value) {
+        ++live;
+    }
+
+    Tracked& operator=(const Tracked& other) {
+        if (copies_left-- == 0) {
+            throw std::runtime_error("copy failed");
+        }
+        value = other.value;
+        return *this;
+    }
+
+    Tracked& operator=(Tracked&& other) noexcept = default;
+
+    ~Tracked() {
+        --live;
+    }
+};
+
+TEST(BufferTestSuite, InsertThrowTest) {
+    Tracked::copies_left = 100;
+    {
+        ExtBuffer<Tracked> buffer(16);
+        for (int i = 0; i < 6; ++i) {
+            buffer.push_back(Tracked(i));
+        }
+        const std::vector<Tracked> values = {10, 11, 12, 13};
+        for (size_t position : {1, 5}) {
+            Tracked::copies_left = 2;
+            ASSERT_THROW(buffer.insert(position, values.begin(), values.end()), std::runtime_error);
+            ASSERT_EQ(buffer.size(), 6);
+            ASSERT_EQ(Tracked::live, 10);
+        }
+        Tracked::copies_left = 100;
+        buffer.insert(3, values.begin(), values.end());
+        ASSERT_EQ(buffer.size(), 10);
+        ASSERT_EQ(buffer[3].value, 10);
+        ASSERT_EQ(buffer[6].value, 13);
+    }
+    ASSERT_EQ(Tracked::live, 0);
+}
+
+TEST(BufferTestSuite, MaskedBufferTest) {
+    MaskedBuffer<int> ring(5);
+    ASSERT_EQ(ring.max_size(), 8);
+    for (int i = 0; i < 21; ++i) {
+        ring.push_back(i);
+    }
+    ASSERT_EQ(ring.size(), 8);
+    ASSERT_EQ(ring.end() - ring.begin(), 8);
+    ASSERT_EQ(std::vector<int>(ring.begin(), ring.end()), std::vector<int>({13, 14, 15, 16, 17, 18, 19, 20}));
+    ASSERT_EQ(ring[7], 20);
+    ASSERT_EQ(ring.begin()[3], 16);
+
+    std::sort(ring.begin(), ring.end(), std::greater<>());
+    ASSERT_EQ(ring[0], 20);
+    ASSERT_EQ(ring[7], 13);
+    ring.pop_front();
+    ASSERT_EQ(*std::min_element(ring.begin(), ring.end()), 13);
+    static_assert(std::random_access_iterator<MaskedBuffer<int>::iterator>);
+    static_assert(sizeof(MaskedBuffer<int>::iterator) == 3 * sizeof(void*));
+
+    MaskedBuffer<std::string> words(2);
+    words.push_back("a");
+    words.push_back("b");
+    words.push_back(words[0]);
+    ASSERT_EQ(words[0], "b");
+    ASSERT_EQ(words[1], "a");
+}
+
+TEST(BufferTestSuite, BulkTransferTest) {
+    Buffer<int> ring(6);
+    std::vector<int> values = {1, 2, 3, 4};
+    ring.push_back(values);
+    ring.pop_front(3);
+    ring.append(values.begin(), values.end());  // wraps around the end of the storage
+    auto [first, second] = ring.as_spans();
+    ASSERT_EQ(first.size() + second.size(), 5);
+    ASSERT_FALSE(second.empty());
+    ASSERT_EQ(first[0], 4);
+    ring.push_back(std::vector<int>(10, 7));
+    ASSERT_EQ(ring.size(), 6);
+    ASSERT_EQ(ring[0], 7);
+
+    std::vector<int> out(4);
+    ASSERT_EQ(ring.read_into(out), 4);
+    ASSERT_EQ(ring.size(), 2);
+    ASSERT_THROW(ring.pop_front(3), std::invalid_argument);
+
+    ExtBuffer<std::string> lines = {"a", "b"};
+    lines.pop_front();
+    std::list<std::string> more = {"c", "d", "e", "f"};
+    lines.append(more.begin(), more.end());
+    ASSERT_EQ(lines.size(), 5);
+    std::vector<std::string> taken(3);
+    ASSERT_EQ(lines.read_into(taken), 3);
+    ASSERT_EQ(taken, std::vector<std::string>({"b", "c", "d"}));
+    const auto [head, tail] = std::as_const(lines).as_spans();
+    ASSERT_EQ(head.size() + tail.size(), 2);
+    ASSERT_EQ(head[0], "e");
+
+    ExtBuffer<int> numbers;
+    std::vector<int> big(1000);
+    std::iota(big.begin(), big.end(), 0);
+    numbers.push_back(big);
+    numbers.pop_front(600);
+    numbers.push_back(big);
+    std::vector<int> all(numbers.size());
+    ASSERT_EQ(numbers.read_into(all), 1400);
+    ASSERT_EQ(all[0], 600);
+    ASSERT_EQ(all[400], 0);
+    ASSERT_TRUE(numbers.empty());
+}
+
+TEST(BufferTestSuite, SnapshotTest) {
+    const std::string path = (std::filesystem::temp_directory_path() / "stl_algo_snapshot.bin").string();
+    Buffer<int> ring(7);
+    for (int i = 0; i < 12; ++i) {
+        ring.push_back(i);  // wraps around, keeping 5 ... 11
+    }
+    ring.save(path);
+    Buffer<int> copied;
+    copied.load(path);
+    ASSERT_EQ(copied.max_size(), 7);
+    ASSERT_EQ(copied.size(), 7);
+    ASSERT_EQ(copied[0], 5);
+    ASSERT_EQ(copied[6], 11);
+#if defined(__linux__)
+    MaskedBuffer<int> mapped;  // 8 slots, so the same file fits the masked layout
+    mapped.load(path, LoadMode::Map);
+    ASSERT_EQ(mapped.size(), 7);
+    mapped.push_back(12);
+    mapped.push_back(13);
+    ASSERT_EQ(mapped[0], 6);
+    ASSERT_EQ(mapped[7], 13);
+#endif
+
+    ExtBuffer<double> samples;
+    for (int i = 0; i < 100; ++i) {
+        samples.push_back(i * 0.5);
+    }
+    samples.pop_front(40);
+    samples.save(path);
+#if defined(__linux__)
+    ExtBuffer<double> grown;
+    grown.load(path, LoadMode::Map);
+    ASSERT_EQ(grown.size(), 60);
+    ASSERT_EQ(grown[0], 20.0);
+    for (int i = 0; i < 200; ++i) {
+        grown.push_back(-i);  // moves off the mapping
+    }
+    ASSERT_EQ(grown[59], 49.5);
+    ASSERT_EQ(grown[60], 0.0);
+#endif
+
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(kSnapshotHeaderBytes + 50 * sizeof(double)));
+        file.put('x');
+    }
+    ExtBuffer<double> checked = {1.0};
+    ASSERT_THROW(checked.load(path), std::invalid_argument);
+    ASSERT_EQ(checked.size(), 1);
+    ASSERT_THROW(copied.load(path), std::invalid_argument);
+
+    Buffer<int>().save(path);
+    Buffer<int> emptied(4);
+    emptied.push_back(1);
+    emptied.load(path);
+    ASSERT_TRUE(emptied.empty());
+    ExtBuffer<int>().save(path);
+    ExtBuffer<int> ext_emptied = {1, 2};
+    ext_emptied.load(path);
+    ASSERT_TRUE(ext_emptied.empty());
+    ext_emptied.push_back(3);
+    ASSERT_EQ(ext_emptied[0], 3);
+    std::filesystem::remove(path);
+}
+
+TEST(BufferTestSuite, CopyCompareTest) {
+    Buffer<int> ring(5);
+    MaskedBuffer<int> masked(5);
+    for (int i = 0; i < 9; ++i) {
+        ring.push_back(i);
+        masked.push_back(i + 3);  // the two rings wrap at different elements
+    }
+    const Buffer<int> copy = ring;
+    ASSERT_TRUE(copy == ring);
+    Buffer<int> other(5);
+    other = ring;
+    ASSERT_TRUE(other == copy);
+    other.push_back(1);
+    ASSERT_TRUE(other != copy);
+    ASSERT_EQ(std::vector<int>(masked.begin(), masked.end()), std::vector<int>({4, 5, 6, 7, 8, 9, 10, 11}));
+    MaskedBuffer<int> masked_copy;
+    masked_copy = masked;
+    ASSERT_TRUE(masked_copy == masked);
+
+    ExtBuffer<int> shifted = {0, 0, 0};
+    shifted.pop_front(3);
+    for (int i = 4; i < 9; ++i) {
+        shifted.push_back(i);  // wraps around the end of the storage
+    }
+    ExtBuffer<int> flat(copy.begin(), copy.end());
+    ASSERT_TRUE(flat == shifted);
+    flat[2] = 0;
+    ASSERT_FALSE(flat == shifted);
+    flat = shifted;
+    ASSERT_TRUE(flat == shifted);
+    flat.assign(flat.begin() + 1, flat.end());
+    ASSERT_EQ(flat.size(), 4);
+    ASSERT_EQ(flat[0], 5);
+
+    ExtBuffer<std::string> words = {"a", "b"};
+    ExtBuffer<std::string> same = words;
+    ASSERT_TRUE(same == words);
+    same.assign({"a", "c"});
+    ASSERT_FALSE(same == words);
+
+    const MaskedBuffer<int> no_storage;
+    MaskedBuffer<int> from_empty(no_storage);
+    ASSERT_TRUE(from_empty == no_storage);
+    masked_copy = no_storage;
+    ASSERT_TRUE(masked_copy.empty());
+    Buffer<int> drained(3);
+    other = drained;
+    ASSERT_TRUE(other == drained);
+    const ExtBuffer<std::string> no_words;
+    ExtBuffer<std::string> from_no_words(no_words);
+    ASSERT_TRUE(from_no_words == no_words);
+    same = no_words;
+    ASSERT_TRUE(same.empty());
+    same.push_back("d");
+    ASSERT_EQ(same[0], "d");
+    ExtBuffer<std::string> unallocated;
+    unallocated = no_words;
+    unallocated.assign(from_no_words.begin(), from_no_words.end());
+    ASSERT_TRUE(unallocated == no_words);
+
+    struct Entry {
+        int key;
+        int hits;  // not part of the value
+
+        bool operator==(const Entry& other) const {
+            return key == other.key;
+        }
+    };
+    static_assert(std::has_unique_object_representations_v<Entry>);
+    Buffer<Entry> entries(2);
+    entries.push_back({1, 0});
+    entries.push_back({2, 0});
+    Buffer<Entry> counted(2);
+    counted.push_back({1, 5});
+    counted.push_back({2, 7});
+    ASSERT_TRUE(entries == counted);
+
+    Tracked::copies_left = 100;
+    {
+        ExtBuffer<Tracked> filled = {Tracked(1)};
+        Tracked::copies_left = 3;
+        ASSERT_THROW(filled.assign(Tracked(2), 5), std::runtime_error);
+        ASSERT_EQ(filled.size(), 3);
+        ASSERT_EQ(Tracked::live, 3);
+        Tracked::copies_left = 100;
+        filled.assign(Tracked(3), 4);
+        ASSERT_EQ(filled.size(), 4);
+        ASSERT_EQ(filled[3].value, 3);
+    }
+    ASSERT_EQ(Tracked::live, 0);
+}
+
+TEST(SpscBufferTestSuite, PoliciesTest) {
+    SpscBuffer<std::string> reject(3);
+    ASSERT_EQ(reject.capacity(), 4);
+    for (const char* word : {"a", "b", "c", "d"}) {
+        ASSERT_TRUE(reject.push_back(word));
+    }
+    ASSERT_FALSE(reject.push_back("e"));
+    std::string word;
+    ASSERT_TRUE(reject.pop_front(word));
+    ASSERT_EQ(word, "a");
+    std::vector<std::string> more = {"f", "g"};
+    ASSERT_EQ(reject.append(more.begin(), more.end()), 1);
+    std::vector<std::string> out(8);
+    ASSERT_EQ(reject.read_into(out), 4);
+    ASSERT_EQ(out[3], "f");
+    ASSERT_TRUE(reject.empty());
+
+    SpscBuffer<int, OverwriteOldest> latest(4);
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(latest.push_back(i));
+    }
+    ASSERT_EQ(latest.size(), 4);
+    int value = 0;
+    ASSERT_TRUE(latest.pop_front(value));
+    ASSERT_EQ(value, 6);
+    std::vector<int> batch = {10, 11, 12, 13, 14, 15};
+    ASSERT_EQ(latest.push_back(batch), 4);
+    std::vector<int> values(8);
+    ASSERT_EQ(latest.read_into(values), 4);
+    ASSERT_EQ(values[0], 12);
+    ASSERT_EQ(values[3], 15);
+    ASSERT_FALSE(latest.pop_front(value));
+}
+
+TEST(SpscBufferTestSuite, HandOffTest) {
+    constexpr uint64_t kCount = 200000;
+    SpscBuffer<uint64_t> queue(256);
+    std::thread producer([&] {
+        std::vector<uint64_t> batch;
+        for (uint64_t i = 0; i < kCount;) {
+            if (i % 3 == 0) {
+                i += queue.push_back(i) ? 1 : 0;
+                continue;
+            }
+            batch.clear();
+            for (uint64_t j = i; j < std::min(kCount, i + 17); ++j) {
+                batch.push_back(j);
+            }
+            i += queue.push_back(batch);
+        }
+    });
+    std::vector<uint64_t> out(32);
+    uint64_t expected = 0;
+    while (expected < kCount) {
+        const size_t count = queue.read_into(out);
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT_EQ(out[i], expected++);
+        }
+    }
+    producer.join();
+
+    SpscBuffer<std::string, OverwriteOldest> latest(64);
+    std::thread writer([&] {
+        for (uint64_t i = 0; i < kCount; ++i) {
+            latest.push_back(std::to_string(i));
+        }
+    });
+    std::vector<std::string> seen(16);
+    int64_t last = -1;
+    while (last + 1 < static_cast<int64_t>(kCount)) {
+        const size_t count = latest.read_into(seen);
+        for (size_t i = 0; i < count; ++i) {
+            const int64_t value = std::stoll(seen[i]);
+            ASSERT_GT(value, last);
+            last = value;
+        }
+    }
+    writer.join();
+}
+
+TEST(BroadcastBufferTestSuite, GateTest) {
+    BroadcastBuffer<std::string> ring(4, 2);
+    for (const char* word : {"a", "b", "c", "d"}) {
+        ASSERT_TRUE(ring.push_back(word));
+    }
+    ASSERT_FALSE(ring.push_back("e"));
+
+    auto [first, second] = ring.read(0, 3);
+    ASSERT_EQ(first.size() + second.size(), 3);
+    const std::string* a = &first[0];
+    ASSERT_EQ(*a, "a");
+    ring.release(0, 3);
+    ASSERT_FALSE(ring.push_back("e"));  // consumer 1 has not read anything yet
+
+    std::vector<std::string> out(4);
+    ASSERT_EQ(ring.read_into(1, out), 4);
+    ASSERT_EQ(out, std::vector<std::string>({"a", "b", "c", "d"}));
+    std::vector<std::string> more = {"e", "f", "g", "h"};
+    ASSERT_EQ(ring.push_back(more), 3);
+    auto [head, tail] = ring.read(0);
+    ASSERT_EQ(head.size() + tail.size(), 4);
+    ASSERT_EQ(tail.back(), "g");
+
+    ring.detach(1);
+    ring.release(0, 4);
+    ASSERT_TRUE(ring.push_back("h"));
+    ASSERT_EQ(ring.read_into(1, out), 0);
+    ring.attach(1);
+    ASSERT_TRUE(ring.push_back("i"));
+    ASSERT_EQ(ring.read_into(1, out), 1);
+    ASSERT_EQ(out[0], "i");
+}
+
+TEST(BroadcastBufferTestSuite, ConsumersTest) {
+    constexpr uint64_t kCount = 20000;
+    BroadcastBuffer<uint64_t> ring(64, 3);
+    std::vector<uint64_t> sums(3);
+    std::vector<std::thread> consumers;
+    for (size_t id = 0; id < 3; ++id) {
+        consumers.emplace_back([&, id] {
+            uint64_t expected = 0;
+            while (expected < kCount) {
+                auto [first, second] = ring.read(id, 1 + id * 7);
+                for (auto piece : {first, second}) {
+                    for (uint64_t value : piece) {
+                        ASSERT_EQ(value, expected++);
+                        sums[id] += value;
+                    }
+                }
+                ring.release(id, first.size() + second.size());
+                if (first.empty()) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (uint64_t i = 0; i < kCount;) {
+        auto [first, second] = ring.claim(5);
+        size_t count = 0;
+        for (auto piece : {first, second}) {
+            for (uint64_t& slot : piece) {
+                if (i + count < kCount) {
+                    slot = i + count++;
+                }
+            }
+        }
+        ring.publish(count);
+        i += count;
+        if (count == 0) {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+    ASSERT_EQ(sums, std::vector<uint64_t>(3, kCount * (kCount - 1) / 2));
+
+    BroadcastBuffer<uint64_t, DropSlowConsumers> lossy(16, 2);
+    std::atomic<bool> done = false;
+    std::vector<std::thread> readers;
+    for (size_t id = 0; id < 2; ++id) {
+        readers.emplace_back([&, id] {
+            std::vector<uint64_t> out(id == 0 ? 8 : 1);
+            uint64_t next = 0;
+            for (;;) {
+                const bool finished = done.load();
+                if (lossy.detached(id)) {
+                    lossy.attach(id);
+                }
+                const size_t count = lossy.read_into(id, out);
+                for (size_t i = 0; i < count; ++i) {
+                    ASSERT_GE(out[i], next);
+                    next = out[i] + 1;
+                }
+                if (count == 0 && finished) {
+                    break;
+                }
+                if (count == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (uint64_t i = 0; i < kCount;) {
+        if (lossy.push_back(i)) {
+            ++i;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+}
+
+TEST(BroadcastBufferTestSuite, AttachWhileWritingTest) {
+    constexpr uint64_t kCount = 200000;
+    BroadcastBuffer<uint64_t> ring(8, 1);
+    ring.detach(0);
+    std::atomic<bool> done = false;
+    std::thread writer([&] {
+        for (uint64_t i = 0; i < kCount;) {
+            if (!ring.push_back(i) || ++i % 64 == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+    });
+    // Every attach must start at a slot the writer has not reused, so the values read after it run on
+    // without a gap.
+    while (!done.load()) {
+        ring.attach(0);
+        uint64_t next = kCount;
+        for (int batch = 0; batch < 4; ++batch) {
+            auto [first, second] = ring.read(0);
+            for (auto piece : {first, second}) {
+                for (uint64_t value : piece) {
+                    if (next != kCount) {
+                        ASSERT_EQ(value, next);
+                    }
+                    next = value + 1;
+                }
+            }
+            ring.release(0, first.size() + second.size());
+            std::this_thread::yield();
+        }
+        ring.detach(0);
+        std::this_thread::yield();
+    }
+    writer.join();
+}
+
+TEST(WindowBufferTestSuite, AggregatesTest) {
+    WindowBuffer<int, decltype([](int x) { return x < 0; }), decltype([](int x) { return x % 2 == 0; })> window(4);
+    for (int value : {5, -3, 8, 1, 7, -2, 4}) {
+        window.push_back(value);
+    }
+    // The window now holds 1, 7, -2, 4.
+    ASSERT_EQ(window.size(), 4);
+    ASSERT_EQ(window.sum(), 10);
+    ASSERT_DOUBLE_EQ(window.mean(), 2.5);
+    ASSERT_EQ(window.min(), -2);
+    ASSERT_EQ(window.max(), 7);
+    ASSERT_TRUE(window.one_of<0>());
+    ASSERT_EQ(window.count_if<1>(), 2);
+    window.pop_front();
+    window.pop_front();
+    ASSERT_EQ(window.max(), 4);
+    ASSERT_FALSE(window.all_of<1>() && window.none_of<0>());
+    window.pop_front();
+    ASSERT_TRUE(window.all_of<1>());
+    ASSERT_TRUE(window.none_of<0>());
+    window.pop_front();
+    ASSERT_THROW(window.min(), std::invalid_argument);
+    ASSERT_THROW(WindowBuffer<int>(0), std::invalid_argument);
+}
+
+TEST(WindowBufferTestSuite, SlidingTest) {
+    WindowBuffer<double> window(100);
+    std::deque<double> recent;
+    uint32_t seed = 777;
+    for (int step = 0; step < 5000; ++step) {
+        seed = seed * 1664525u + 1013904223u;
+        const double value = (seed >> 8) % 2 == 0 ? (seed % 1000) * 1e6 : (seed % 1000) * 1e-6;
+        window.push_back(value);
+        recent.push_back(value);
+        if (recent.size() > 100) {
+            recent.pop_front();
+        }
+        ASSERT_EQ(window.min(), *std::min_element(recent.begin(), recent.end()));
+        ASSERT_EQ(window.max(), *std::max_element(recent.begin(), recent.end()));
+    }
+    long double exact = 0;
+    for (double value : recent) {
+        exact += value;
+    }
+    ASSERT_NEAR(window.sum(), static_cast<double>(exact), 1e-6);
+    ASSERT_TRUE(std::equal(window.begin(), window.end(), recent.begin()));
+}
+
+#if defined(__linux__)
+TEST(MirroredBufferTestSuite, ContiguousTest) {
+    MirroredBuffer<char> bytes(100);
+    ASSERT_EQ(bytes.max_size() % 4096, 0);
+    const size_t capacity = bytes.max_size();
+    std::string chunk(capacity - 10, 'a');
+    bytes.push_back(std::span<const char>(chunk));
+    bytes.pop_front(capacity - 30);
+    const std::string message = "a message that runs past the end of the storage";
+    bytes.push_back(std::span<const char>(message.data(), message.size()));
+    ASSERT_EQ(bytes.size(), 20 + message.size());
+    ASSERT_EQ(std::string_view(bytes.data() + 20, message.size()), message);
+    ASSERT_EQ(std::memcmp(bytes.end() - message.size(), message.data(), message.size()), 0);
+
+    auto spare = bytes.spare();
+    ASSERT_EQ(spare.size(), capacity - bytes.size());
+    std::memcpy(spare.data(), "xyz", 3);
+    bytes.commit(3);
+    ASSERT_EQ(bytes[bytes.size() - 1], 'z');
+    std::string out(bytes.size(), ' ');
+    ASSERT_EQ(bytes.read_into(out), out.size());
+    ASSERT_EQ(out.substr(20), message + "xyz");
+
+    MirroredBuffer<int64_t> numbers(8);
+    for (int64_t i = 0; i < 3000; ++i) {
+        numbers.push_back(i);
+    }
+    ASSERT_EQ(numbers.size(), numbers.max_size());
+    ASSERT_EQ(numbers[0], 3000 - static_cast<int64_t>(numbers.max_size()));
+    ASSERT_TRUE(std::is_sorted(numbers.begin(), numbers.end()));
+    MirroredBuffer<int64_t> copy = numbers;
+    ASSERT_TRUE(std::equal(copy.begin(), copy.end(), numbers.begin(), numbers.end()));
+}
+#endif
+
+TEST(AllocatorTestSuite, ArenaTest) {
+    using Strings = ExtBuffer<std::string, std::pmr::polymorphic_allocator<std::string>>;
+    std::array<std::byte, 4096> stack;
+    MonotonicArena arena(stack);
+    MonotonicArena other;
+    Strings words(4, &arena);
+    for (int i = 0; i < 100; ++i) {
+        words.push_back(std::to_string(i));
+    }
+    ASSERT_GT(arena.allocated(), 0);
+    ASSERT_EQ(other.allocated(), 0);
+
+    Strings copy(words);  // polymorphic allocators are not copied along with the buffer
+    ASSERT_EQ(copy.get_allocator().resource(), std::pmr::get_default_resource());
+    Strings elsewhere(&other);
+    elsewhere = std::move(words);  // different arenas: the elements move, the storage stays
+    ASSERT_EQ(elsewhere.get_allocator().resource(), &other);
+    ASSERT_GT(other.allocated(), 0);
+    ASSERT_EQ(elsewhere.size(), 100);
+    ASSERT_EQ(elsewhere[99], "99");
+
+    Buffer<int, std::pmr::polymorphic_allocator<int>> recent(3, &arena);
+    for (int i = 0; i < 5; ++i) {
+        recent.push_back(i);
+    }
+    Buffer<int, std::pmr::polymorphic_allocator<int>> moved(std::move(recent));
+    ASSERT_EQ(moved.get_allocator().resource(), &arena);
+    ASSERT_EQ(moved[0], 2);
+}
+
+TEST(AllocatorTestSuite, UnequalMoveTest) {
+    using Ints = Buffer<int, std::pmr::polymorphic_allocator<int>>;
+    MonotonicArena source_arena;
+    MonotonicArena target_arena;
+    Ints target(4, &target_arena);
+    target.push_back(1);
+    Ints empty(&source_arena);
+    target = std::move(empty);
+    ASSERT_EQ(target.get_allocator().resource(), &target_arena);
+    ASSERT_EQ(target.size(), 0);
+    ASSERT_EQ(target.max_size(), 0);
+
+    Ints full(3, &source_arena);
+    for (int i = 0; i < 3; ++i) {
+        full.push_back(i);
+    }
+    target = std::move(full);
+    ASSERT_EQ(target.get_allocator().resource(), &target_arena);
+    ASSERT_EQ(target.max_size(), 3);
+    ASSERT_EQ(target, Ints({0, 1, 2}));
+}
+
+TEST(AllocatorTestSuite, PoolTest) {
+    FixedPool pool(256, 4);
+    for (int round = 0; round < 100; ++round) {
+        ExtBuffer<int, std::pmr::polymorphic_allocator<int>> request(20, &pool);
+        for (int i = 0; i < 30; ++i) {
+            request.push_back(i);
+        }
+        ASSERT_EQ(request[29], 29);
+    }
+    ASSERT_EQ(pool.chunks(), 1);
+
+    ExtBuffer<int64_t, HugePageAllocator<int64_t>> large;
+    large.reserve(HugePageAllocator<int64_t>::kHugePageBytes / sizeof(int64_t) * 2);
+    for (int64_t i = 0; i < 1000; ++i) {
+        large.push_back(i);
+    }
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(&large[0]) % HugePageAllocator<int64_t>::kHugePageBytes, 0);
+    ASSERT_EQ(large[999], 999);
+
+    Buffer<float, AlignedAllocator<float>> lanes(100);
+    lanes.push_back(1.0f);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(&lanes[0]) % 64, 0);
+    static_assert(std::is_nothrow_move_assignable_v<Buffer<float, AlignedAllocator<float>>>);
+}